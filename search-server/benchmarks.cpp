@@ -0,0 +1,775 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <map>
+#include <execution>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_duration.h"
+#include "posting_list.h"
+#include "bit_packing.h"
+#include "concurrent_map.h"
+#include "search_server.h"
+#include "document_filter.h"
+#include "durable_search_server.h"
+#include "query_result_cache.h"
+#include "snapshot_search_server.h"
+#include "segmented_search_server.h"
+#include "string_processing.h"
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+    // словарь из слов вида "w123", частые слова с маленьким номером встречаются чаще
+    std::string GenerateText(std::mt19937 &generator, int dictionary_size, int word_count)
+    {
+        std::geometric_distribution<int> word_distribution(10.0 / dictionary_size);
+        std::string text;
+        for (int i = 0; i < word_count; ++i)
+        {
+            if (!text.empty())
+            {
+                text += ' ';
+            }
+            text += 'w' + std::to_string(word_distribution(generator) % dictionary_size);
+        }
+        return text;
+    }
+}
+
+void BenchmarkPostingListScan(std::ostream &out, int document_count, int repeat_count)
+{
+    std::mt19937 generator(42);
+    std::geometric_distribution<int> count_distribution(0.7);
+
+    // одинаковые данные во всех раскладках: каждый третий документ содержит слово
+    std::map<int, int> map_postings;
+    std::vector<int> vector_document_ids;
+    std::vector<int> vector_term_counts;
+    PostingList posting_list;
+    for (int document_id = 0; document_id < document_count; document_id += 3)
+    {
+        const int term_count = 1 + count_distribution(generator);
+        map_postings[document_id] = term_count;
+        vector_document_ids.push_back(document_id);
+        vector_term_counts.push_back(term_count);
+        posting_list.Add(document_id, term_count);
+    }
+    out << "Posting list scan, "s << map_postings.size() << " postings x "s << repeat_count << " repeats"s << std::endl;
+
+    long long map_sum = 0;
+    {
+        LOG_DURATION_STREAM("  std::map<int, int>"s, out);
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            for (const auto &[document_id, term_count] : map_postings)
+            {
+                map_sum += term_count * (document_id & 1);
+            }
+        }
+    }
+    long long vector_sum = 0;
+    {
+        LOG_DURATION_STREAM("  uncompressed vectors"s, out);
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            for (std::size_t j = 0; j < vector_document_ids.size(); ++j)
+            {
+                vector_sum += vector_term_counts[j] * (vector_document_ids[j] & 1);
+            }
+        }
+    }
+    long long list_sum = 0;
+    {
+        LOG_DURATION_STREAM("  PostingList"s, out);
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            posting_list.ForEach([&list_sum](int document_id, int term_count)
+                                 { list_sum += term_count * (document_id & 1); });
+        }
+    }
+    // печатаем суммы, чтобы компилятор не выбросил циклы
+    out << "  checksums: "s << map_sum << " / "s << vector_sum << " / "s << list_sum << std::endl;
+}
+
+void BenchmarkPostingListMemory(std::ostream &out, int document_count, int repeat_count)
+{
+    // несжатая раскладка прежнего PostingList: id и TF в двух массивах
+    struct UncompressedPostings
+    {
+        std::vector<int> document_ids;
+        std::vector<double> term_frequencies;
+    };
+    std::mt19937 generator(42);
+    std::map<std::string, UncompressedPostings> uncompressed_index;
+    std::map<std::string, PostingList> compressed_index;
+    long long posting_count = 0;
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        std::map<std::string, int> word_counts;
+        for (const std::string_view word : SplitIntoWords(GenerateText(generator, 20'000, 70)))
+        {
+            ++word_counts[std::string(word)];
+        }
+        for (const auto &[word, term_count] : word_counts)
+        {
+            UncompressedPostings &postings = uncompressed_index[word];
+            postings.document_ids.push_back(document_id);
+            postings.term_frequencies.push_back(term_count / 70.0);
+            compressed_index[word].Add(document_id, term_count);
+            ++posting_count;
+        }
+    }
+
+    std::size_t uncompressed_bytes = 0;
+    for (const auto &[word, postings] : uncompressed_index)
+    {
+        uncompressed_bytes += sizeof(UncompressedPostings) + postings.document_ids.capacity() * sizeof(int)
+                            + postings.term_frequencies.capacity() * sizeof(double);
+    }
+    std::size_t compressed_bytes = 0;
+    for (const auto &[word, postings] : compressed_index)
+    {
+        compressed_bytes += postings.GetMemoryUsage();
+    }
+    out << "Posting list memory, "s << document_count << " documents, "s << uncompressed_index.size() << " words, "s
+        << posting_count << " postings"s << std::endl;
+    out << "  uncompressed: "s << uncompressed_bytes << " bytes, "s << static_cast<double>(uncompressed_bytes) / posting_count
+        << " bytes per posting"s << std::endl;
+    out << "  PostingList: "s << compressed_bytes << " bytes, "s << static_cast<double>(compressed_bytes) / posting_count
+        << " bytes per posting"s << std::endl;
+
+    double uncompressed_sum = 0;
+    {
+        LOG_DURATION_STREAM("  uncompressed scan"s, out);
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            for (const auto &[word, postings] : uncompressed_index)
+            {
+                for (std::size_t j = 0; j < postings.document_ids.size(); ++j)
+                {
+                    uncompressed_sum += postings.term_frequencies[j] * (postings.document_ids[j] & 1);
+                }
+            }
+        }
+    }
+    double compressed_sum = 0;
+    {
+        LOG_DURATION_STREAM("  PostingList scan"s, out);
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            for (const auto &[word, postings] : compressed_index)
+            {
+                postings.ForEach([&compressed_sum](int document_id, int term_count)
+                                 { compressed_sum += term_count / 70.0 * (document_id & 1); });
+            }
+        }
+    }
+    out << "  checksums: "s << uncompressed_sum << " / "s << compressed_sum << std::endl;
+}
+
+void BenchmarkBitUnpacking(std::ostream &out, int block_count, int bit_width)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<std::uint32_t> value_distribution(0, (std::uint32_t{1} << bit_width) - 1);
+    std::vector<std::uint32_t> packed(static_cast<std::size_t>(block_count) * GetPackedWordCount(bit_width));
+    std::uint32_t values[PACKED_BLOCK_SIZE];
+    for (int block = 0; block < block_count; ++block)
+    {
+        for (std::uint32_t &value : values)
+        {
+            value = value_distribution(generator);
+        }
+        PackBlock(values, bit_width, packed.data() + static_cast<std::size_t>(block) * GetPackedWordCount(bit_width));
+    }
+    out << "Block unpacking, "s << block_count << " blocks of "s << bit_width << " bits"s << std::endl;
+
+    const auto unpack_all = [&](auto unpack)
+    {
+        std::uint32_t checksum = 0;
+        for (int block = 0; block < block_count; ++block)
+        {
+            unpack(packed.data() + static_cast<std::size_t>(block) * GetPackedWordCount(bit_width), bit_width, values);
+            checksum += values[block % PACKED_BLOCK_SIZE];
+        }
+        return checksum;
+    };
+    std::uint32_t simd_checksum = 0;
+    {
+        LOG_DURATION_STREAM("  UnpackBlock"s, out);
+        simd_checksum = unpack_all(UnpackBlock);
+    }
+    std::uint32_t scalar_checksum = 0;
+    {
+        LOG_DURATION_STREAM("  UnpackBlockScalar"s, out);
+        scalar_checksum = unpack_all(UnpackBlockScalar);
+    }
+    out << "  checksums: "s << simd_checksum << " / "s << scalar_checksum << std::endl;
+}
+
+void BenchmarkConcurrentMap(std::ostream &out, int document_count, int posting_count)
+{
+    // синтетический корпус: записи (id документа, IDF * TF), частые документы встречаются чаще
+    std::mt19937 generator(42);
+    std::geometric_distribution<int> document_distribution(10.0 / document_count);
+    std::uniform_real_distribution<double> score_distribution(0.0, 1.0);
+    std::vector<std::pair<int, double>> postings(posting_count);
+    for (auto &[document_id, score] : postings)
+    {
+        document_id = document_distribution(generator) % document_count;
+        score = score_distribution(generator);
+    }
+    out << "ConcurrentMap accumulation, "s << posting_count << " postings over "s << document_count << " documents"s << std::endl;
+
+    for (const int thread_count : {1, 2, 4, 8, 16, 32})
+    {
+        for (const int bucket_count : {1, 16, 64, 256, 1024, 4096})
+        {
+            ConcurrentMap<int, double> scores(bucket_count);
+            {
+                LOG_DURATION_STREAM("  threads = "s + std::to_string(thread_count) + ", buckets = "s + std::to_string(bucket_count), out);
+                std::vector<std::thread> threads;
+                for (int thread_index = 0; thread_index < thread_count; ++thread_index)
+                {
+                    threads.emplace_back([&, thread_index]
+                    {
+                        for (int i = thread_index; i < posting_count; i += thread_count)
+                        {
+                            scores[postings[i].first].ref_to_value += postings[i].second;
+                        }
+                    });
+                }
+                for (std::thread &thread : threads)
+                {
+                    thread.join();
+                }
+            }
+        }
+    }
+}
+
+
+void BenchmarkMatchDocument(std::ostream &out, int document_count, int query_word_count)
+{
+    std::mt19937 generator(42);
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        search_server.AddDocument(document_id, GenerateText(generator, 1000, 70), DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const std::string query = GenerateText(generator, 1000, query_word_count) + " -w999"s;
+    out << "MatchDocument over "s << document_count << " documents, "s << query_word_count << " query words"s << std::endl;
+
+    const auto match_all = [&](const auto &policy)
+    {
+        std::size_t word_count = 0;
+        for (const int document_id : search_server)
+        {
+            word_count += std::get<0>(search_server.MatchDocument(policy, query, document_id)).size();
+        }
+        return word_count;
+    };
+    std::size_t seq_words = 0;
+    {
+        LOG_DURATION_STREAM("  seq"s, out);
+        seq_words = match_all(std::execution::seq);
+    }
+    std::size_t par_words = 0;
+    {
+        LOG_DURATION_STREAM("  par"s, out);
+        par_words = match_all(std::execution::par);
+    }
+    out << "  matched words: "s << seq_words << " / "s << par_words << std::endl;
+}
+
+void BenchmarkFindTopDocuments(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        search_server.AddDocument(document_id, GenerateText(generator, 10'000, 70), DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    out << "FindTopDocuments over "s << document_count << " documents, "s << query_count << " queries"s << std::endl;
+
+    const auto run_queries = [&](const std::string &name, const std::vector<std::string> &queries)
+    {
+        std::size_t result_count = 0;
+        {
+            LOG_DURATION_STREAM("  "s + name, out);
+            for (const std::string &query : queries)
+            {
+                result_count += search_server.FindTopDocuments(query).size();
+            }
+        }
+        out << "  results: "s << result_count << std::endl;
+    };
+    std::vector<std::string> common_queries;
+    std::vector<std::string> long_queries;
+    std::vector<std::string> rare_queries;
+    // частые слова вперемешку со словами средней частоты: блоки частых слов почти все безнадёжны
+    std::vector<std::string> mixed_queries;
+    std::uniform_int_distribution<int> rare_word_distribution(9'000, 9'999);
+    std::uniform_int_distribution<int> middle_word_distribution(500, 2'000);
+    for (int i = 0; i < query_count; ++i)
+    {
+        common_queries.push_back(GenerateText(generator, 100, 3));
+        long_queries.push_back(GenerateText(generator, 300, 10));
+        rare_queries.push_back('w' + std::to_string(rare_word_distribution(generator)));
+        mixed_queries.push_back(GenerateText(generator, 10, 2) + " w"s + std::to_string(middle_word_distribution(generator))
+                                + " w"s + std::to_string(middle_word_distribution(generator)));
+    }
+    // одно частое плюс-слово без минус-слов, с частым и с редким минус-словом
+    std::vector<std::string> plus_queries;
+    std::vector<std::string> common_minus_queries;
+    std::vector<std::string> rare_minus_queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        const std::string plus_word = 'w' + std::to_string(i % 10);
+        plus_queries.push_back(plus_word);
+        common_minus_queries.push_back(plus_word + " -w"s + std::to_string(10 + i % 10));
+        rare_minus_queries.push_back(plus_word + " -w"s + std::to_string(rare_word_distribution(generator)));
+    }
+    run_queries("common words"s, common_queries);
+    run_queries("10 common words"s, long_queries);
+    run_queries("rare words"s, rare_queries);
+    run_queries("common and middle words"s, mixed_queries);
+    run_queries("plus word"s, plus_queries);
+    run_queries("plus word, common minus word"s, common_minus_queries);
+    run_queries("plus word, rare minus word"s, rare_minus_queries);
+}
+
+void BenchmarkIndexFile(std::ostream &out, int document_count)
+{
+    std::mt19937 generator(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < document_count; ++i)
+    {
+        texts.push_back(GenerateText(generator, 20'000, 70));
+    }
+    std::vector<DocumentToAdd> documents;
+    for (int i = 0; i < document_count; ++i)
+    {
+        documents.push_back({i, texts[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_benchmark_index.bin").string();
+    out << "Index file, "s << document_count << " documents"s << std::endl;
+
+    SearchServer search_server(""s);
+    {
+        LOG_DURATION_STREAM("  AddDocuments"s, out);
+        search_server.AddDocuments(documents);
+    }
+    {
+        LOG_DURATION_STREAM("  SaveIndex"s, out);
+        search_server.SaveIndex(path);
+    }
+    out << "  file size: "s << std::filesystem::file_size(path) << " bytes"s << std::endl;
+    std::size_t result_count = 0;
+    {
+        LOG_DURATION_STREAM("  OpenIndex + first query"s, out);
+        const SearchServer opened = SearchServer::OpenIndex(path);
+        result_count = opened.FindTopDocuments("w1 w2 -w3"s).size();
+    }
+    out << "  results: "s << result_count << std::endl;
+    std::filesystem::remove(path);
+}
+
+void BenchmarkWriteAheadLog(std::ostream &out, int document_count, int thread_count)
+{
+    std::mt19937 generator(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < document_count; ++i)
+    {
+        texts.push_back(GenerateText(generator, 20'000, 30));
+    }
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "search_server_benchmark_wal";
+    out << "Write-ahead log, "s << document_count << " AddDocument calls"s << std::endl;
+
+    SearchServer search_server(""s);
+    {
+        LOG_DURATION_STREAM("  without log"s, out);
+        for (int i = 0; i < document_count; ++i)
+        {
+            search_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1});
+        }
+    }
+    // один поток ждёт fsync на каждый документ, несколько потоков делят fsync на группу
+    for (const int threads : {1, thread_count})
+    {
+        std::filesystem::remove_all(directory);
+        DurableSearchServer durable_server(directory.string(), ""s);
+        {
+            LOG_DURATION_STREAM("  with log, "s + std::to_string(threads) + " threads"s, out);
+            std::vector<std::thread> workers;
+            for (int thread = 0; thread < threads; ++thread)
+            {
+                workers.emplace_back([&, thread]
+                                     {
+                                         for (int i = thread; i < document_count; i += threads)
+                                         {
+                                             durable_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1});
+                                         }
+                                     });
+            }
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+        }
+        {
+            LOG_DURATION_STREAM("  replay"s, out);
+            const DurableSearchServer replayed(directory.string(), ""s);
+            out << "  documents: "s << replayed.GetSearchServer().GetDocumentCount() << std::endl;
+        }
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void BenchmarkQueryResultCache(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < document_count; ++i)
+    {
+        texts.push_back(GenerateText(generator, 20'000, 30));
+    }
+    std::vector<DocumentToAdd> documents;
+    for (int i = 0; i < document_count; ++i)
+    {
+        documents.push_back({i, texts[i], DocumentStatus::ACTUAL, {i % 10}});
+    }
+    SearchServer search_server(""s);
+    search_server.AddDocuments(documents);
+
+    // 1000 разных запросов, номер запроса распределён геометрически: немногие частые запросы дают большую часть нагрузки
+    std::vector<std::string> distinct_queries;
+    for (int i = 0; i < 1'000; ++i)
+    {
+        distinct_queries.push_back(GenerateText(generator, 2'000, 3));
+    }
+    std::geometric_distribution<int> query_distribution(0.01);
+    std::vector<std::string_view> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(distinct_queries[query_distribution(generator) % distinct_queries.size()]);
+    }
+    out << "Query result cache, "s << document_count << " documents, "s << query_count << " skewed queries"s << std::endl;
+
+    std::size_t result_count = 0;
+    {
+        LOG_DURATION_STREAM("  without cache"s, out);
+        for (const std::string_view query : queries)
+        {
+            result_count += search_server.FindTopDocuments(query).size();
+        }
+    }
+    QueryResultCache cache(search_server, 1 << 20);
+    std::size_t cached_result_count = 0;
+    {
+        LOG_DURATION_STREAM("  with cache"s, out);
+        for (const std::string_view query : queries)
+        {
+            cached_result_count += cache.FindTopDocuments(query).size();
+        }
+    }
+    out << "  results: "s << result_count << " / "s << cached_result_count << ", hits: "s << cache.GetHitCount()
+        << ", misses: "s << cache.GetMissCount() << ", memory: "s << cache.GetMemoryUsage() << " bytes"s << std::endl;
+}
+
+void BenchmarkSnapshotSearchServer(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 2 * document_count; ++i)
+    {
+        texts.push_back(GenerateText(generator, 20'000, 30));
+    }
+    std::vector<DocumentToAdd> documents;
+    for (int i = 0; i < document_count; ++i)
+    {
+        documents.push_back({i, texts[i], DocumentStatus::ACTUAL, {1}});
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(GenerateText(generator, 2'000, 3));
+    }
+    out << "Queries during ingest, "s << document_count << " documents + "s << document_count << " added"s << std::endl;
+
+    // search(query) и add(i) вызываются из разных потоков; печатаем медиану и худшую задержку запроса
+    const auto run = [&](const std::string &name, const auto &search, const auto &add)
+    {
+        std::atomic<bool> is_writing = true;
+        std::thread writer([&]
+                           {
+                               for (int i = document_count; i < 2 * document_count && is_writing; ++i)
+                               {
+                                   add(i);
+                               }
+                           });
+        std::vector<double> latencies;
+        for (const std::string &query : queries)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            search(query);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        is_writing = false;
+        writer.join();
+        std::sort(latencies.begin(), latencies.end());
+        out << "  "s << name << ": median "s << static_cast<int>(latencies[latencies.size() / 2]) << " us, max "s
+            << static_cast<int>(latencies.back()) << " us"s << std::endl;
+    };
+
+    SearchServer locked_server(""s);
+    locked_server.AddDocuments(documents);
+    std::mutex mutex;
+    run("one mutex"s, [&](const std::string &query)
+        {
+            std::lock_guard guard(mutex);
+            return locked_server.FindTopDocuments(query).size();
+        },
+        [&](int i)
+        {
+            std::lock_guard guard(mutex);
+            locked_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1});
+        });
+
+    SearchServer initial_server(""s);
+    initial_server.AddDocuments(documents);
+    SnapshotSearchServer snapshot_server(std::move(initial_server));
+    run("snapshots"s, [&](const std::string &query)
+        { return snapshot_server.GetSnapshot()->FindTopDocuments(query).size(); },
+        [&](int i)
+        { snapshot_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1}); });
+}
+
+void BenchmarkSegmentedSearchServer(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < document_count; ++i)
+    {
+        texts.push_back(GenerateText(generator, 20'000, 30));
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(GenerateText(generator, 2'000, 3));
+    }
+    out << "Segmented index, "s << document_count << " documents, every 4th removed, "s << query_count << " queries"s << std::endl;
+
+    const auto run = [&](const std::string &name, auto &server, const auto &finish_ingest)
+    {
+        {
+            LOG_DURATION_STREAM("  "s + name + " AddDocument + RemoveDocument"s, out);
+            for (int i = 0; i < document_count; ++i)
+            {
+                server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {i % 10});
+                if (i % 4 == 0)
+                {
+                    server.RemoveDocument(i / 2);
+                }
+            }
+            finish_ingest();
+        }
+        std::size_t result_count = 0;
+        {
+            LOG_DURATION_STREAM("  "s + name + " FindTopDocuments"s, out);
+            for (const std::string &query : queries)
+            {
+                result_count += server.FindTopDocuments(query).size();
+            }
+        }
+        out << "  results: "s << result_count << std::endl;
+    };
+    SearchServer search_server(""s);
+    run("one server"s, search_server, [] {});
+    SegmentedSearchServer segmented_server(std::string_view{});
+    run("segments"s, segmented_server, [&]
+        {
+            segmented_server.WaitForMerges();
+            out << "  segments: "s << segmented_server.GetSegmentCount() << std::endl;
+        });
+}
+
+void BenchmarkStatusPartitions(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> percent_distribution(0, 99);
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        // 95% документов ACTUAL, остальные поровну между прочими статусами
+        const int percent = percent_distribution(generator);
+        const DocumentStatus status = percent < 95 ? DocumentStatus::ACTUAL : static_cast<DocumentStatus>(1 + percent % 3);
+        search_server.AddDocument(document_id, GenerateText(generator, 10'000, 70), status, {1, 2, 3});
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(GenerateText(generator, 300, 3));
+    }
+    out << "Status queries over "s << document_count << " documents (95% ACTUAL), "s << query_count << " queries"s << std::endl;
+
+    const auto run_queries = [&](const std::string &name, const auto &find)
+    {
+        std::size_t result_count = 0;
+        {
+            LOG_DURATION_STREAM("  "s + name, out);
+            for (const std::string &query : queries)
+            {
+                result_count += find(query).size();
+            }
+        }
+        out << "  results: "s << result_count << std::endl;
+    };
+    for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED})
+    {
+        const std::string status_name = status == DocumentStatus::ACTUAL ? "ACTUAL"s : "BANNED"s;
+        // фильтр по статусу проходит списки всех статусов, как до разделения
+        run_queries(status_name + " by filter"s, [&](const std::string &query)
+                    { return search_server.FindTopDocuments(query, [status](int, DocumentStatus document_status, int)
+                                                            { return document_status == status; }); });
+        run_queries(status_name + " by status"s, [&](const std::string &query)
+                    { return search_server.FindTopDocuments(query, status); });
+    }
+}
+
+void BenchmarkDocumentFilter(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> rating_distribution(-10, 10);
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        // частые слова из небольшого словаря и одно слово из большого, по которому запросы избирательны
+        search_server.AddDocument(document_id, GenerateText(generator, 1'000, 70) + " "s + GenerateText(generator, 20'000, 1), DocumentStatus::ACTUAL,
+                                  {rating_distribution(generator)});
+    }
+    std::vector<std::string> common_queries;
+    std::vector<std::string> rare_queries;
+    std::uniform_int_distribution<int> rare_word_distribution(1'000, 19'999);
+    for (int i = 0; i < query_count; ++i)
+    {
+        common_queries.push_back(GenerateText(generator, 1'000, 3));
+        rare_queries.push_back('w' + std::to_string(rare_word_distribution(generator)));
+    }
+    out << "Rating and id range filter over "s << document_count << " documents, "s << query_count << " queries"s << std::endl;
+
+    const int max_document_id = document_count / 2;
+    const DocumentFilter filter = DocumentFilter().SetRatingRange(5, 10).SetIdRange(0, max_document_id);
+    const auto lambda = [max_document_id](int document_id, DocumentStatus, int rating)
+    { return 5 <= rating && rating <= 10 && 0 <= document_id && document_id <= max_document_id; };
+    const auto run_queries = [&](const std::string &name, const std::vector<std::string> &queries, const auto &filtering_predicat)
+    {
+        std::size_t result_count = 0;
+        {
+            LOG_DURATION_STREAM("  "s + name, out);
+            for (const std::string &query : queries)
+            {
+                result_count += search_server.FindTopDocuments(query, filtering_predicat).size();
+            }
+        }
+        out << "  results: "s << result_count << std::endl;
+    };
+    run_queries("common words, lambda"s, common_queries, lambda);
+    run_queries("common words, DocumentFilter"s, common_queries, filter);
+    run_queries("rare word, lambda"s, rare_queries, lambda);
+    run_queries("rare word, DocumentFilter"s, rare_queries, filter);
+
+    // сама проверка столбцов: SSE против скалярной версии
+    std::vector<int> document_ids(document_count);
+    std::vector<int> ratings(document_count);
+    for (int i = 0; i < document_count; ++i)
+    {
+        document_ids[i] = i;
+        ratings[i] = rating_distribution(generator);
+    }
+    std::vector<std::uint64_t> selection(DocumentFilter::GetSelectionWordCount(document_count));
+    std::uint64_t checksum = 0;
+    {
+        LOG_DURATION_STREAM("  SelectInRanges x "s + std::to_string(query_count), out);
+        for (int i = 0; i < query_count; ++i)
+        {
+            filter.SelectInRanges(document_ids.data(), ratings.data(), document_count, selection.data());
+            checksum += selection[i % selection.size()];
+        }
+    }
+    {
+        LOG_DURATION_STREAM("  SelectInRangesScalar x "s + std::to_string(query_count), out);
+        for (int i = 0; i < query_count; ++i)
+        {
+            filter.SelectInRangesScalar(document_ids.data(), ratings.data(), document_count, selection.data());
+            checksum += selection[i % selection.size()];
+        }
+    }
+    out << "  checksum: "s << checksum << std::endl;
+}
+
+void BenchmarkRatingIndex(std::ostream &out, int document_count, int query_count)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> rating_distribution(0, 999);
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        search_server.AddDocument(document_id, GenerateText(generator, 1'000, 70), DocumentStatus::ACTUAL, {rating_distribution(generator)});
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(GenerateText(generator, 1'000, 3));
+    }
+    out << "Rating at least N over "s << document_count << " documents, "s << query_count << " three-word queries"s << std::endl;
+
+    // доля подходящих документов от 0.1% до 20%: индекс рейтингов выгоден только на узких отрезках
+    for (const int min_rating : {999, 990, 950, 800})
+    {
+        const DocumentFilter filter = DocumentFilter().SetRatingRange(min_rating, std::numeric_limits<int>::max());
+        const auto lambda = [min_rating](int, DocumentStatus, int rating)
+        { return rating >= min_rating; };
+        const auto run_queries = [&](const std::string &name, const auto &filtering_predicat)
+        {
+            std::size_t result_count = 0;
+            {
+                LOG_DURATION_STREAM("  rating >= "s + std::to_string(min_rating) + ", "s + name, out);
+                for (const std::string &query : queries)
+                {
+                    result_count += search_server.FindTopDocuments(query, filtering_predicat).size();
+                }
+            }
+            out << "  results: "s << result_count << std::endl;
+        };
+        run_queries("lambda"s, lambda);
+        run_queries("DocumentFilter"s, filter);
+    }
+}
+
+void RunBenchmarks(std::ostream &out)
+{
+    BenchmarkPostingListScan(out, 3'000'000, 20);
+    BenchmarkPostingListMemory(out, 20'000, 20);
+    BenchmarkBitUnpacking(out, 200'000, 7);
+    BenchmarkConcurrentMap(out, 100'000, 2'000'000);
+    BenchmarkMatchDocument(out, 10'000, 500);
+    BenchmarkFindTopDocuments(out, 50'000, 1'000);
+    BenchmarkIndexFile(out, 100'000);
+    BenchmarkWriteAheadLog(out, 2'000, 16);
+    BenchmarkQueryResultCache(out, 50'000, 20'000);
+    BenchmarkSnapshotSearchServer(out, 20'000, 2'000);
+    BenchmarkSegmentedSearchServer(out, 100'000, 2'000);
+    BenchmarkStatusPartitions(out, 50'000, 1'000);
+    BenchmarkDocumentFilter(out, 50'000, 1'000);
+    BenchmarkRatingIndex(out, 50'000, 1'000);
+}
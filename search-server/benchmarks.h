@@ -0,0 +1,49 @@
+#pragma once
+
+#include <iostream>
+
+// сравнение скорости прохода по списку документов слова: std::map, несжатые массивы и сжатый PostingList
+void BenchmarkPostingListScan(std::ostream& out, int document_count, int repeat_count);
+
+// память и скорость прохода всех списков документов синтетического корпуса: несжатые массивы против PostingList
+void BenchmarkPostingListMemory(std::ostream& out, int document_count, int repeat_count);
+
+// распаковка блоков: SSE против скалярной версии
+void BenchmarkBitUnpacking(std::ostream& out, int block_count, int bit_width);
+
+// накопление релевантности в ConcurrentMap: перебор числа корзин и числа потоков на синтетическом корпусе
+void BenchmarkConcurrentMap(std::ostream& out, int document_count, int posting_count);
+
+// MatchDocument по всем документам, как в MatchDocuments из test_example_functions: seq против par
+void BenchmarkMatchDocument(std::ostream& out, int document_count, int query_word_count);
+
+// FindTopDocuments на синтетическом корпусе: частые слова (много кандидатов) и редкие (избирательный запрос)
+void BenchmarkFindTopDocuments(std::ostream& out, int document_count, int query_count);
+
+// построение индекса через AddDocuments против SaveIndex и OpenIndex с первым запросом
+void BenchmarkIndexFile(std::ostream& out, int document_count);
+
+// AddDocument без журнала, с журналом из одного потока и из thread_count потоков (групповой fsync), повтор журнала
+void BenchmarkWriteAheadLog(std::ostream& out, int document_count, int thread_count);
+
+// FindTopDocuments с кэшем ответов и без на потоке запросов, где частые запросы повторяются
+void BenchmarkQueryResultCache(std::ostream& out, int document_count, int query_count);
+
+// задержка запросов, пока другой поток добавляет документы: сервер под одним мьютексом против снимков
+void BenchmarkSnapshotSearchServer(std::ostream& out, int document_count, int query_count);
+
+// добавление с удалениями и поиск: один SearchServer против сегментов с фоновыми слияниями
+void BenchmarkSegmentedSearchServer(std::ostream& out, int document_count, int query_count);
+
+// FindTopDocuments по статусу: по спискам своего статуса против фильтра по всем спискам, частый статус и редкий
+void BenchmarkStatusPartitions(std::ostream& out, int document_count, int query_count);
+
+// фильтр по отрезкам рейтинга и id: лямбда против DocumentFilter на широких и избирательных запросах,
+// и проверка столбцов SSE против скалярной
+void BenchmarkDocumentFilter(std::ostream& out, int document_count, int query_count);
+
+// поиск документов с рейтингом не меньше N: лямбда по всем кандидатам против индекса рейтингов
+void BenchmarkRatingIndex(std::ostream& out, int document_count, int query_count);
+
+// запускает все замеры с размерами по умолчанию
+void RunBenchmarks(std::ostream& out);
@@ -0,0 +1,173 @@
+#include "bit_packing.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr int VALUES_PER_LANE = PACKED_BLOCK_SIZE / PACKED_LANE_COUNT;
+    constexpr int BITS_PER_WORD = 32;
+
+    std::uint32_t GetBitMask(int bit_width)
+    {
+        return bit_width == BITS_PER_WORD ? ~std::uint32_t{0} : (std::uint32_t{1} << bit_width) - 1;
+    }
+}
+
+int GetRequiredBitWidth(const std::uint32_t *values)
+{
+    std::uint32_t all_bits = 0;
+    for (int i = 0; i < PACKED_BLOCK_SIZE; ++i)
+    {
+        all_bits |= values[i];
+    }
+    int bit_width = 0;
+    while (bit_width < BITS_PER_WORD && (all_bits >> bit_width) != 0)
+    {
+        ++bit_width;
+    }
+    return bit_width;
+}
+
+int GetPackedWordCount(int bit_width)
+{
+    // в полосе 32 числа по bit_width бит - ровно bit_width слов
+    return PACKED_LANE_COUNT * bit_width;
+}
+
+void PackBlock(const std::uint32_t *values, int bit_width, std::uint32_t *packed)
+{
+    std::fill(packed, packed + GetPackedWordCount(bit_width), 0);
+    if (bit_width == 0)
+    {
+        return;
+    }
+    for (int j = 0; j < VALUES_PER_LANE; ++j)
+    {
+        const int word = j * bit_width / BITS_PER_WORD;
+        const int offset = j * bit_width % BITS_PER_WORD;
+        for (int lane = 0; lane < PACKED_LANE_COUNT; ++lane)
+        {
+            const std::uint32_t value = values[j * PACKED_LANE_COUNT + lane];
+            packed[word * PACKED_LANE_COUNT + lane] |= value << offset;
+            // число не поместилось в слово целиком - старшие биты уходят в следующее слово полосы
+            if (offset + bit_width > BITS_PER_WORD)
+            {
+                packed[(word + 1) * PACKED_LANE_COUNT + lane] |= value >> (BITS_PER_WORD - offset);
+            }
+        }
+    }
+}
+
+void UnpackBlockScalar(const std::uint32_t *packed, int bit_width, std::uint32_t *values)
+{
+    if (bit_width == 0)
+    {
+        std::fill(values, values + PACKED_BLOCK_SIZE, 0);
+        return;
+    }
+    const std::uint32_t mask = GetBitMask(bit_width);
+    for (int j = 0; j < VALUES_PER_LANE; ++j)
+    {
+        const int word = j * bit_width / BITS_PER_WORD;
+        const int offset = j * bit_width % BITS_PER_WORD;
+        for (int lane = 0; lane < PACKED_LANE_COUNT; ++lane)
+        {
+            std::uint32_t value = packed[word * PACKED_LANE_COUNT + lane] >> offset;
+            if (offset + bit_width > BITS_PER_WORD)
+            {
+                value |= packed[(word + 1) * PACKED_LANE_COUNT + lane] << (BITS_PER_WORD - offset);
+            }
+            values[j * PACKED_LANE_COUNT + lane] = value & mask;
+        }
+    }
+}
+
+void UnpackBlock(const std::uint32_t *packed, int bit_width, std::uint32_t *values)
+{
+#if defined(__SSE2__)
+    if (bit_width == 0)
+    {
+        std::fill(values, values + PACKED_BLOCK_SIZE, 0);
+        return;
+    }
+    // тот же алгоритм, что в скалярной версии, но сразу для всех четырёх полос
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(GetBitMask(bit_width)));
+    const __m128i *packed_words = reinterpret_cast<const __m128i *>(packed);
+    __m128i *output = reinterpret_cast<__m128i *>(values);
+    for (int j = 0; j < VALUES_PER_LANE; ++j)
+    {
+        const int word = j * bit_width / BITS_PER_WORD;
+        const int offset = j * bit_width % BITS_PER_WORD;
+        __m128i value = _mm_srl_epi32(_mm_loadu_si128(packed_words + word), _mm_cvtsi32_si128(offset));
+        if (offset + bit_width > BITS_PER_WORD)
+        {
+            const __m128i high_bits = _mm_sll_epi32(_mm_loadu_si128(packed_words + word + 1), _mm_cvtsi32_si128(BITS_PER_WORD - offset));
+            value = _mm_or_si128(value, high_bits);
+        }
+        _mm_storeu_si128(output + j, _mm_and_si128(value, mask));
+    }
+#else
+    UnpackBlockScalar(packed, bit_width, values);
+#endif
+}
+
+void EncodeDeltas(const std::uint32_t *ids, std::uint32_t base, std::uint32_t *deltas)
+{
+    for (int i = 0; i < PACKED_BLOCK_SIZE; ++i)
+    {
+        deltas[i] = ids[i] - (i < PACKED_LANE_COUNT ? base : ids[i - PACKED_LANE_COUNT]);
+    }
+}
+
+void DecodeDeltasScalar(std::uint32_t *values, std::uint32_t base)
+{
+    for (int i = 0; i < PACKED_BLOCK_SIZE; ++i)
+    {
+        values[i] += i < PACKED_LANE_COUNT ? base : values[i - PACKED_LANE_COUNT];
+    }
+}
+
+void DecodeDeltas(std::uint32_t *values, std::uint32_t base)
+{
+#if defined(__SSE2__)
+    __m128i *vectors = reinterpret_cast<__m128i *>(values);
+    __m128i previous = _mm_set1_epi32(static_cast<int>(base));
+    for (int j = 0; j < VALUES_PER_LANE; ++j)
+    {
+        previous = _mm_add_epi32(previous, _mm_loadu_si128(vectors + j));
+        _mm_storeu_si128(vectors + j, previous);
+    }
+#else
+    DecodeDeltasScalar(values, base);
+#endif
+}
+
+int EncodeVarint(std::uint32_t value, std::uint8_t *bytes)
+{
+    int size = 0;
+    while (value >= 0x80)
+    {
+        bytes[size++] = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = static_cast<std::uint8_t>(value);
+    return size;
+}
+
+std::uint32_t ReadVarint(const std::uint8_t *&data)
+{
+    std::uint32_t value = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        const std::uint8_t byte = *data++;
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// упаковка блоков по 128 беззнаковых чисел в минимальное общее число бит.
+// Раскладка вертикальная: число i лежит в полосе i % 4, у каждой полосы свои 32-битные слова,
+// слова полос чередуются. Так SSE распаковывает четыре соседних числа одной командой,
+// а скалярная версия работает с той же раскладкой по одной полосе
+constexpr int PACKED_BLOCK_SIZE = 128;
+constexpr int PACKED_LANE_COUNT = 4;
+
+// сколько бит нужно, чтобы записать наибольшее из чисел блока
+int GetRequiredBitWidth(const std::uint32_t* values);
+
+// число 32-битных слов в упакованном блоке
+int GetPackedWordCount(int bit_width);
+
+void PackBlock(const std::uint32_t* values, int bit_width, std::uint32_t* packed);
+
+// распаковка SSE2-кодом, если он доступен при сборке, иначе скалярная
+void UnpackBlock(const std::uint32_t* packed, int bit_width, std::uint32_t* values);
+void UnpackBlockScalar(const std::uint32_t* packed, int bit_width, std::uint32_t* values);
+
+// разности с шагом в полосу: ids[i] - ids[i - 4], для первых четырёх - разность с base.
+// Возрастающие id дают небольшие неотрицательные числа, а восстановление - это сложение векторов
+void EncodeDeltas(const std::uint32_t* ids, std::uint32_t base, std::uint32_t* deltas);
+
+// восстанавливает id из разностей на месте
+void DecodeDeltas(std::uint32_t* values, std::uint32_t base);
+void DecodeDeltasScalar(std::uint32_t* values, std::uint32_t base);
+
+// числа переменной длины: по 7 бит в байте, старший бит - признак продолжения.
+// Запись занимает не больше MAX_VARINT_SIZE байт, возвращается их число
+constexpr int MAX_VARINT_SIZE = 5;
+int EncodeVarint(std::uint32_t value, std::uint8_t* bytes);
+std::uint32_t ReadVarint(const std::uint8_t*& data);
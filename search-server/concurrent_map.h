@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <type_traits>
+
+// словарь, разбитый на корзины со своим мьютексом: потоки, пишущие в разные корзины, не ждут друг друга.
+// Ключ целочисленный, корзина выбирается по остатку от деления ключа на число корзин
+template <typename Key, typename Value>
+class ConcurrentMap
+{
+public:
+    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
+
+    // пока объект Access жив, корзина с его значением заблокирована
+    struct Access
+    {
+        std::lock_guard<std::mutex> guard;
+        Value& ref_to_value;
+    };
+
+    explicit ConcurrentMap(std::size_t bucket_count) : buckets_(bucket_count)
+    {
+    }
+
+    Access operator[](const Key& key)
+    {
+        Bucket& bucket = GetBucket(key);
+        return {std::lock_guard(bucket.mutex), bucket.map[key]};
+    }
+
+    void Erase(const Key& key)
+    {
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        bucket.map.erase(key);
+    }
+
+    // сливает все корзины в обычный словарь; каждая корзина блокируется на время копирования
+    std::map<Key, Value> BuildOrdinaryMap()
+    {
+        std::map<Key, Value> result;
+        for (Bucket& bucket : buckets_)
+        {
+            std::lock_guard guard(bucket.mutex);
+            result.insert(bucket.map.begin(), bucket.map.end());
+        }
+        return result;
+    }
+
+private:
+    struct Bucket
+    {
+        std::mutex mutex;
+        std::map<Key, Value> map;
+    };
+
+    std::vector<Bucket> buckets_;
+
+    Bucket& GetBucket(const Key& key)
+    {
+        // приводим к беззнаковому, чтобы отрицательные ключи не давали отрицательный номер корзины
+        return buckets_[static_cast<std::make_unsigned_t<Key>>(key) % buckets_.size()];
+    }
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 struct Document
 {
@@ -23,4 +26,23 @@ enum class DocumentStatus
     REMOVED
 };
 
+// число значений DocumentStatus
+constexpr int DOCUMENT_STATUS_COUNT = 4;
+
+// документ для пакетного добавления SearchServer::AddDocuments; текст должен жить до конца вызова
+struct DocumentToAdd
+{
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// документ пакета, который не удалось добавить, и причина
+struct AddDocumentError
+{
+    int document_id = 0;
+    std::string message;
+};
+
 std::ostream& operator<<(std::ostream& out, const Document& doc);
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "document_filter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std::literals::string_literals;
+
+DocumentFilter &DocumentFilter::SetStatuses(std::initializer_list<DocumentStatus> statuses)
+{
+    if (statuses.size() == 0)
+    {
+        throw std::invalid_argument("Status set of a filter must not be empty"s);
+    }
+    status_mask_ = 0;
+    for (const DocumentStatus status : statuses)
+    {
+        status_mask_ |= std::uint32_t{1} << static_cast<int>(status);
+    }
+    return *this;
+}
+
+DocumentFilter &DocumentFilter::SetRatingRange(int min_rating, int max_rating)
+{
+    if (min_rating > max_rating)
+    {
+        throw std::invalid_argument("Rating range of a filter must not be empty"s);
+    }
+    min_rating_ = min_rating;
+    max_rating_ = max_rating;
+    return *this;
+}
+
+DocumentFilter &DocumentFilter::SetIdRange(int min_document_id, int max_document_id)
+{
+    if (min_document_id > max_document_id)
+    {
+        throw std::invalid_argument("Id range of a filter must not be empty"s);
+    }
+    min_document_id_ = min_document_id;
+    max_document_id_ = max_document_id;
+    return *this;
+}
+
+std::uint32_t DocumentFilter::GetStatusMask() const
+{
+    return status_mask_;
+}
+
+bool DocumentFilter::HasRanges() const
+{
+    return min_rating_ != std::numeric_limits<int>::min() || max_rating_ != std::numeric_limits<int>::max()
+        || min_document_id_ != std::numeric_limits<int>::min() || max_document_id_ != std::numeric_limits<int>::max();
+}
+
+int DocumentFilter::GetMinRating() const
+{
+    return min_rating_;
+}
+
+int DocumentFilter::GetMaxRating() const
+{
+    return max_rating_;
+}
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status, int rating) const
+{
+    return (status_mask_ >> static_cast<int>(status) & 1) != 0 && IsInRanges(document_id, rating);
+}
+
+bool DocumentFilter::IsInRanges(int document_id, int rating) const
+{
+    return min_rating_ <= rating && rating <= max_rating_ && min_document_id_ <= document_id && document_id <= max_document_id_;
+}
+
+void DocumentFilter::SelectInRangesScalar(const int *document_ids, const int *ratings, int document_count, std::uint64_t *selection) const
+{
+    for (int first = 0; first < document_count; first += BITS_PER_SELECTION_WORD)
+    {
+        std::uint64_t word = 0;
+        const int last = std::min(first + BITS_PER_SELECTION_WORD, document_count);
+        for (int i = first; i < last; ++i)
+        {
+            word |= static_cast<std::uint64_t>(IsInRanges(document_ids[i], ratings[i])) << (i - first);
+        }
+        selection[first / BITS_PER_SELECTION_WORD] = word;
+    }
+}
+
+void DocumentFilter::SelectInRanges(const int *document_ids, const int *ratings, int document_count, std::uint64_t *selection) const
+{
+#if defined(__SSE2__)
+    constexpr int LANE_COUNT = 4;
+    const __m128i min_ratings = _mm_set1_epi32(min_rating_);
+    const __m128i max_ratings = _mm_set1_epi32(max_rating_);
+    const __m128i min_ids = _mm_set1_epi32(min_document_id_);
+    const __m128i max_ids = _mm_set1_epi32(max_document_id_);
+    // целые слова карты - по 16 четвёрок, остаток проверяется скалярно
+    const int vector_count = document_count - document_count % BITS_PER_SELECTION_WORD;
+    for (int first = 0; first < vector_count; first += BITS_PER_SELECTION_WORD)
+    {
+        std::uint64_t word = 0;
+        for (int i = 0; i < BITS_PER_SELECTION_WORD; i += LANE_COUNT)
+        {
+            const __m128i rating = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ratings + first + i));
+            const __m128i id = _mm_loadu_si128(reinterpret_cast<const __m128i *>(document_ids + first + i));
+            // единицы в полосах, которые вышли за какой-нибудь конец отрезка
+            const __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(rating, min_ratings), _mm_cmpgt_epi32(rating, max_ratings)),
+                                                 _mm_or_si128(_mm_cmplt_epi32(id, min_ids), _mm_cmpgt_epi32(id, max_ids)));
+            const int outside_bits = _mm_movemask_ps(_mm_castsi128_ps(outside));
+            word |= static_cast<std::uint64_t>(~outside_bits & 0xF) << i;
+        }
+        selection[first / BITS_PER_SELECTION_WORD] = word;
+    }
+    SelectInRangesScalar(document_ids + vector_count, ratings + vector_count, document_count - vector_count, selection + vector_count / BITS_PER_SELECTION_WORD);
+#else
+    SelectInRangesScalar(document_ids, ratings, document_count, selection);
+#endif
+}
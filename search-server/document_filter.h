@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+
+#include "document.h"
+
+// декларативный фильтр документов: набор статусов и отрезки рейтингов и внешних id, концы включаются.
+// В отличие от лямбды сервер знает, что проверяется: статусы выбирают списки документов слов,
+// а отрезки проверяются пачками по столбцам рейтингов и id, а не по одному документу
+class DocumentFilter
+{
+public:
+    // без условий подходит любой документ
+    DocumentFilter() = default;
+
+    // условия задаются цепочкой: DocumentFilter().SetStatuses({...}).SetRatingRange(3, 5).
+    // Пустой набор статусов и отрезок с min > max бросают std::invalid_argument
+    DocumentFilter& SetStatuses(std::initializer_list<DocumentStatus> statuses);
+    DocumentFilter& SetRatingRange(int min_rating, int max_rating);
+    DocumentFilter& SetIdRange(int min_document_id, int max_document_id);
+
+    // бит i - статус со значением i
+    std::uint32_t GetStatusMask() const;
+
+    // есть ли условия на рейтинг или id
+    bool HasRanges() const;
+
+    // концы отрезка рейтингов; без условия - границы int
+    int GetMinRating() const;
+    int GetMaxRating() const;
+
+    // проверка одного документа, в том числе там, где ждут обычный фильтр-лямбду
+    bool operator()(int document_id, DocumentStatus status, int rating) const;
+
+    // проверяет отрезки у документов [0, document_count) по столбцам и записывает результат битами:
+    // документ i - бит i % 64 слова i / 64, в selection нужно (document_count + 63) / 64 слов.
+    // Статусы не проверяются. SSE2-код проверяет по четыре документа одной командой, если он доступен
+    // при сборке, иначе скалярный
+    void SelectInRanges(const int* document_ids, const int* ratings, int document_count, std::uint64_t* selection) const;
+    void SelectInRangesScalar(const int* document_ids, const int* ratings, int document_count, std::uint64_t* selection) const;
+
+    static int GetSelectionWordCount(int document_count)
+    {
+        return (document_count + BITS_PER_SELECTION_WORD - 1) / BITS_PER_SELECTION_WORD;
+    }
+
+    static bool IsSelected(const std::uint64_t* selection, int document_index)
+    {
+        return (selection[document_index / BITS_PER_SELECTION_WORD] >> (document_index % BITS_PER_SELECTION_WORD) & 1) != 0;
+    }
+
+private:
+    static constexpr int BITS_PER_SELECTION_WORD = 64;
+    static constexpr std::uint32_t ALL_STATUSES = (std::uint32_t{1} << DOCUMENT_STATUS_COUNT) - 1;
+
+    std::uint32_t status_mask_ = ALL_STATUSES;
+    int min_rating_ = std::numeric_limits<int>::min();
+    int max_rating_ = std::numeric_limits<int>::max();
+    int min_document_id_ = std::numeric_limits<int>::min();
+    int max_document_id_ = std::numeric_limits<int>::max();
+
+    bool IsInRanges(int document_id, int rating) const;
+};
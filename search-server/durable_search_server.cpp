@@ -0,0 +1,387 @@
+#include "durable_search_server.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+    const std::string SNAPSHOT_PREFIX = "snapshot-"s;
+    const std::string SNAPSHOT_SUFFIX = ".idx"s;
+
+    template <typename T>
+    void AppendValue(std::string &payload, const T &value)
+    {
+        payload.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void AppendDocument(std::string &payload, int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+    {
+        AppendValue(payload, static_cast<std::int32_t>(document_id));
+        AppendValue(payload, static_cast<std::uint8_t>(status));
+        AppendValue(payload, static_cast<std::uint32_t>(ratings.size()));
+        payload.append(reinterpret_cast<const char *>(ratings.data()), ratings.size() * sizeof(int));
+        AppendValue(payload, static_cast<std::uint32_t>(document.size()));
+        payload.append(document);
+    }
+
+    // читает данные записи журнала по порядку; строки смотрят в данные записи
+    class PayloadReader
+    {
+    public:
+        explicit PayloadReader(std::string_view payload) : payload_(payload)
+        {
+        }
+
+        template <typename T>
+        T Read()
+        {
+            T value;
+            std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+
+        DocumentToAdd ReadDocument()
+        {
+            DocumentToAdd document;
+            document.id = Read<std::int32_t>();
+            document.status = static_cast<DocumentStatus>(Read<std::uint8_t>());
+            document.ratings.resize(Read<std::uint32_t>());
+            const std::string_view ratings = Take(document.ratings.size() * sizeof(int));
+            if (!ratings.empty())
+            {
+                std::memcpy(document.ratings.data(), ratings.data(), ratings.size());
+            }
+            document.text = Take(Read<std::uint32_t>());
+            return document;
+        }
+
+    private:
+        std::string_view payload_;
+
+        std::string_view Take(std::size_t size)
+        {
+            if (size > payload_.size())
+            {
+                throw std::runtime_error("Write-ahead log record is shorter than its contents"s);
+            }
+            const std::string_view result = payload_.substr(0, size);
+            payload_.remove_prefix(size);
+            return result;
+        }
+    };
+}
+
+DurableSearchServer::DurableSearchServer(const std::string &directory, std::string_view stop_words)
+    : directory_(directory), snapshot_sequence_number_(0), server_(LoadSnapshot(directory, stop_words, snapshot_sequence_number_))
+{
+    if (!std::filesystem::exists(GetSnapshotPath(snapshot_sequence_number_)))
+    {
+        // стоп-слова в журнал не попадают, поэтому новый каталог сразу получает пустой снимок с ними
+        WriteSnapshot(0);
+    }
+    // записи до снимка могли остаться в журнале, если процесс упал между записью снимка и очисткой журнала
+    const std::uint64_t last_sequence_number = WriteAheadLog::Replay(GetLogPath(), [this](std::uint64_t sequence_number, std::string_view payload)
+                                                         {
+                                                             if (sequence_number > snapshot_sequence_number_)
+                                                             {
+                                                                 ApplyRecord(payload);
+                                                             }
+                                                         });
+    next_sequence_number_to_apply_ = std::max(last_sequence_number, snapshot_sequence_number_) + 1;
+    log_ = std::make_unique<WriteAheadLog>(GetLogPath(), next_sequence_number_to_apply_);
+}
+
+SearchServer DurableSearchServer::LoadSnapshot(const std::string &directory, std::string_view stop_words, std::uint64_t &sequence_number)
+{
+    std::filesystem::create_directories(directory);
+    sequence_number = 0;
+    bool has_snapshot = false;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= SNAPSHOT_PREFIX.size() + SNAPSHOT_SUFFIX.size() || name.compare(0, SNAPSHOT_PREFIX.size(), SNAPSHOT_PREFIX) != 0 ||
+            name.compare(name.size() - SNAPSHOT_SUFFIX.size(), SNAPSHOT_SUFFIX.size(), SNAPSHOT_SUFFIX) != 0)
+        {
+            continue;
+        }
+        const std::string number = name.substr(SNAPSHOT_PREFIX.size(), name.size() - SNAPSHOT_PREFIX.size() - SNAPSHOT_SUFFIX.size());
+        if (number.find_first_not_of("0123456789"s) != std::string::npos)
+        {
+            continue;
+        }
+        const std::uint64_t snapshot_number = std::stoull(number);
+        if (!has_snapshot || snapshot_number > sequence_number)
+        {
+            sequence_number = snapshot_number;
+            has_snapshot = true;
+        }
+    }
+    if (!has_snapshot)
+    {
+        return SearchServer(stop_words);
+    }
+    return SearchServer::OpenIndex((std::filesystem::path(directory) / (SNAPSHOT_PREFIX + std::to_string(sequence_number) + SNAPSHOT_SUFFIX)).string());
+}
+
+std::string DurableSearchServer::GetLogPath() const
+{
+    return (std::filesystem::path(directory_) / "wal.log").string();
+}
+
+std::string DurableSearchServer::GetSnapshotPath(std::uint64_t sequence_number) const
+{
+    return (std::filesystem::path(directory_) / (SNAPSHOT_PREFIX + std::to_string(sequence_number) + SNAPSHOT_SUFFIX)).string();
+}
+
+bool DurableSearchServer::HasDocument(int document_id) const
+{
+    if (const auto it = pending_documents_.find(document_id); it != pending_documents_.end())
+    {
+        return it->second.is_present;
+    }
+    return server_.document_to_internal_id_.count(document_id) > 0;
+}
+
+void DurableSearchServer::CheckNewDocumentId(int document_id) const
+{
+    if (document_id < 0 || HasDocument(document_id))
+    {
+        throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+    }
+}
+
+void DurableSearchServer::AddPendingDocuments(const std::vector<int> &document_ids, bool is_present)
+{
+    for (const int document_id : document_ids)
+    {
+        PendingDocument &pending = pending_documents_[document_id];
+        pending.is_present = is_present;
+        ++pending.record_count;
+    }
+}
+
+template <typename Function>
+void DurableSearchServer::ApplyWhenDurable(std::uint64_t sequence_number, const std::vector<int> &document_ids, Function apply)
+{
+    try
+    {
+        log_->WaitDurable(sequence_number);
+    }
+    catch (const std::runtime_error &)
+    {
+        // запись не применится никогда; Snapshot, ждущий её, должен проснуться и увидеть сломанный журнал
+        std::lock_guard guard(mutex_);
+        applied_.notify_all();
+        throw;
+    }
+    std::unique_lock lock(mutex_);
+    applied_.wait(lock, [this, sequence_number]
+                  { return next_sequence_number_to_apply_ == sequence_number; });
+    // изменение проверено до записи в журнал, но и неожиданная ошибка не должна задержать следующие записи
+    const auto finish = [&]
+    {
+        for (const int document_id : document_ids)
+        {
+            if (const auto it = pending_documents_.find(document_id); --it->second.record_count == 0)
+            {
+                pending_documents_.erase(it);
+            }
+        }
+        ++next_sequence_number_to_apply_;
+        applied_.notify_all();
+    };
+    try
+    {
+        apply();
+    }
+    catch (...)
+    {
+        finish();
+        throw;
+    }
+    finish();
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    std::string payload;
+    AppendValue(payload, RecordType::ADD_DOCUMENT);
+    AppendDocument(payload, document_id, document, status, ratings);
+    std::unique_lock lock(mutex_);
+    // документ, который сервер не принял бы, в журнал не попадает
+    CheckNewDocumentId(document_id);
+    server_.CountWords(document);
+    const std::uint64_t sequence_number = log_->Append(payload);
+    AddPendingDocuments({document_id}, true);
+    lock.unlock();
+    ApplyWhenDurable(sequence_number, {document_id}, [&]
+                     { server_.AddDocument(document_id, document, status, ratings); });
+}
+
+std::vector<AddDocumentError> DurableSearchServer::AddDocuments(const std::vector<DocumentToAdd> &documents)
+{
+    std::string payload;
+    AppendValue(payload, RecordType::ADD_DOCUMENTS);
+    AppendValue(payload, static_cast<std::uint32_t>(documents.size()));
+    for (const DocumentToAdd &document : documents)
+    {
+        AppendDocument(payload, document.id, document.text, document.status, document.ratings);
+    }
+    std::unique_lock lock(mutex_);
+    // те же проверки и в том же порядке, что в SearchServer::AddDocuments: сначала id, потом слова
+    std::vector<AddDocumentError> errors;
+    std::vector<const DocumentToAdd *> id_accepted;
+    std::set<int> batch_ids;
+    for (const DocumentToAdd &document : documents)
+    {
+        try
+        {
+            CheckNewDocumentId(document.id);
+            if (!batch_ids.insert(document.id).second)
+            {
+                throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+            }
+            id_accepted.push_back(&document);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            errors.push_back({document.id, e.what()});
+        }
+    }
+    std::vector<int> accepted_ids;
+    for (const DocumentToAdd *document : id_accepted)
+    {
+        try
+        {
+            server_.CountWords(document->text);
+            accepted_ids.push_back(document->id);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            errors.push_back({document->id, e.what()});
+        }
+    }
+    if (accepted_ids.empty() && !documents.empty())
+    {
+        return errors;
+    }
+    // пакет пишется целиком: при повторе в том же состоянии сервера те же документы отвергаются снова
+    const std::uint64_t sequence_number = log_->Append(payload);
+    AddPendingDocuments(accepted_ids, true);
+    lock.unlock();
+    ApplyWhenDurable(sequence_number, accepted_ids, [&]
+                     { errors = server_.AddDocuments(documents); });
+    return errors;
+}
+
+void DurableSearchServer::RemoveDocument(int document_id)
+{
+    RemoveDocuments({document_id});
+}
+
+void DurableSearchServer::RemoveDocuments(const std::vector<int> &document_ids)
+{
+    std::string payload;
+    AppendValue(payload, RecordType::REMOVE_DOCUMENTS);
+    AppendValue(payload, static_cast<std::uint32_t>(document_ids.size()));
+    payload.append(reinterpret_cast<const char *>(document_ids.data()), document_ids.size() * sizeof(int));
+    std::unique_lock lock(mutex_);
+    if (!std::all_of(document_ids.begin(), document_ids.end(), [this](int document_id)
+                     { return HasDocument(document_id); }))
+    {
+        throw std::out_of_range("Could not remove document with unknown id"s);
+    }
+    const std::uint64_t sequence_number = log_->Append(payload);
+    AddPendingDocuments(document_ids, false);
+    lock.unlock();
+    ApplyWhenDurable(sequence_number, document_ids, [&]
+                     { server_.RemoveDocuments(document_ids); });
+}
+
+void DurableSearchServer::Snapshot()
+{
+    std::unique_lock lock(mutex_);
+    // снимок должен содержать все записи журнала, который он заменит: ждём, пока писатели применят свои.
+    // Сломанный журнал бросает из Flush, так что в снимок не попадёт ничего, что не подтверждено писателям
+    while (true)
+    {
+        log_->Flush();
+        if (next_sequence_number_to_apply_ > log_->GetLastSequenceNumber())
+        {
+            break;
+        }
+        applied_.wait(lock);
+    }
+    const std::uint64_t sequence_number = log_->GetLastSequenceNumber();
+    if (sequence_number == snapshot_sequence_number_)
+    {
+        return;
+    }
+    WriteSnapshot(sequence_number);
+    log_->Truncate();
+    // старый снимок ещё может быть отображён в память сервером, но удалить файл это не мешает
+    std::filesystem::remove(GetSnapshotPath(snapshot_sequence_number_));
+    snapshot_sequence_number_ = sequence_number;
+}
+
+void DurableSearchServer::WriteSnapshot(std::uint64_t sequence_number) const
+{
+    // снимок появляется под своим именем только целиком: пишем во временный файл и переименовываем
+    const std::string temporary_path = (std::filesystem::path(directory_) / "snapshot.tmp").string();
+    server_.WriteIndex(temporary_path);
+    SyncPath(temporary_path);
+    const std::string snapshot_path = GetSnapshotPath(sequence_number);
+    if (std::rename(temporary_path.c_str(), snapshot_path.c_str()) != 0)
+    {
+        throw std::runtime_error("Could not rename snapshot to "s + snapshot_path);
+    }
+    SyncPath(directory_);
+}
+
+const SearchServer &DurableSearchServer::GetSearchServer() const
+{
+    return server_;
+}
+
+void DurableSearchServer::ApplyRecord(std::string_view payload)
+{
+    PayloadReader reader(payload);
+    switch (static_cast<RecordType>(reader.Read<std::uint8_t>()))
+    {
+    case RecordType::ADD_DOCUMENT:
+    {
+        const DocumentToAdd document = reader.ReadDocument();
+        server_.AddDocument(document.id, document.text, document.status, document.ratings);
+        break;
+    }
+    case RecordType::ADD_DOCUMENTS:
+    {
+        std::vector<DocumentToAdd> documents(reader.Read<std::uint32_t>());
+        for (DocumentToAdd &document : documents)
+        {
+            document = reader.ReadDocument();
+        }
+        server_.AddDocuments(documents);
+        break;
+    }
+    case RecordType::REMOVE_DOCUMENTS:
+    {
+        std::vector<int> document_ids(reader.Read<std::uint32_t>());
+        for (int &document_id : document_ids)
+        {
+            document_id = reader.Read<std::int32_t>();
+        }
+        server_.RemoveDocuments(document_ids);
+        break;
+    }
+    default:
+        throw std::runtime_error("Unknown write-ahead log record type"s);
+    }
+}
+
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer, изменения которого переживают падение процесса. Каталог хранит последний снимок
+// индекса (snapshot-<номер записи>.idx) и журнал изменений после него (wal.log).
+// Изменение сначала проверяется, затем попадает в журнал и только после того, как запись на диске,
+// применяется к серверу - в порядке записей журнала. Изменения из разных потоков делят один fsync на группу.
+// Если запись на диск не удалась, изменение не применяется, а журнал ломается: все следующие изменения
+// и Snapshot бросают std::runtime_error
+class DurableSearchServer
+{
+public:
+    // открывает последний снимок каталога и повторяет журнал поверх него; если снимка нет,
+    // начинает с пустого сервера со стоп-словами stop_words. Каталог создаётся при необходимости
+    DurableSearchServer(const std::string& directory, std::string_view stop_words);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // записывает снимок индекса и очищает журнал; старый снимок удаляется.
+    // Бросает std::runtime_error, если журнал сломан неудачной записью
+    void Snapshot();
+
+    // в сервере только изменения, которые уже на диске. Читать можно, пока в другом потоке нет изменений
+    const SearchServer& GetSearchServer() const;
+
+private:
+    friend class Tests;
+
+    std::string directory_;
+    // номер последней записи журнала, вошедшей в снимок на диске; 0 - пустой снимок нового каталога
+    std::uint64_t snapshot_sequence_number_;
+    SearchServer server_;
+    std::unique_ptr<WriteAheadLog> log_;
+    // проверка изменения и его запись в журнал идут под одной блокировкой, применение к серверу - тоже
+    std::mutex mutex_;
+    // будит писателей, ждущих своей очереди на применение, и Snapshot
+    std::condition_variable applied_;
+    // номер записи журнала, которая применяется к серверу следующей
+    std::uint64_t next_sequence_number_to_apply_;
+
+    // id документов, которые затрагивают записи, уже попавшие в журнал, но ещё не применённые к серверу:
+    // будет ли документ после всех этих записей и сколько их. Проверка новых изменений смотрит сюда раньше сервера
+    struct PendingDocument
+    {
+        bool is_present;
+        int record_count;
+    };
+    std::map<int, PendingDocument> pending_documents_;
+
+    // тип записи журнала - первый байт данных
+    enum class RecordType : std::uint8_t
+    {
+        ADD_DOCUMENT,
+        ADD_DOCUMENTS,
+        REMOVE_DOCUMENTS
+    };
+
+    // открывает снимок с наибольшим номером или создаёт пустой сервер; sequence_number - номер снимка или 0
+    static SearchServer LoadSnapshot(const std::string& directory, std::string_view stop_words, std::uint64_t& sequence_number);
+
+    std::string GetLogPath() const;
+
+    // записывает снимок текущего сервера с номером sequence_number
+    void WriteSnapshot(std::uint64_t sequence_number) const;
+
+    std::string GetSnapshotPath(std::uint64_t sequence_number) const;
+
+    // применяет запись журнала к серверу; ошибки пакетов повторяются так же, как при первом применении
+    void ApplyRecord(std::string_view payload);
+
+    // есть ли документ после всех записей журнала, в том числе не применённых; вызывается под mutex_
+    bool HasDocument(int document_id) const;
+
+    // бросает invalid_argument, как SearchServer::CheckNewDocumentId, но с учётом не применённых записей
+    void CheckNewDocumentId(int document_id) const;
+
+    // запоминает документы записи, только что добавленной в журнал; вызывается под mutex_
+    void AddPendingDocuments(const std::vector<int>& document_ids, bool is_present);
+
+    // ждёт, пока запись окажется на диске, затем в порядке журнала применяет её: apply() под mutex_.
+    // document_ids - документы записи, переданные AddPendingDocuments
+    template <typename Function>
+    void ApplyWhenDurable(std::uint64_t sequence_number, const std::vector<int>& document_ids, Function apply);
+};
@@ -0,0 +1,86 @@
+#include "excluded_documents.h"
+
+#include <algorithm>
+
+ExcludedDocuments::Cursor::Cursor(const ExcludedDocuments &excluded)
+    : excluded_(excluded), position_(excluded.document_ids_.begin())
+{
+}
+
+bool ExcludedDocuments::Cursor::IsExcluded(int document_id)
+{
+    switch (excluded_.strategy_)
+    {
+    case Strategy::NONE:
+        return false;
+    case Strategy::BITMAP:
+        return (excluded_.bitmap_[document_id / BITS_PER_WORD] >> (document_id % BITS_PER_WORD)) & 1;
+    case Strategy::SORTED_LIST:
+        break;
+    }
+    // номера растут, поэтому продолжаем поиск с места предыдущей проверки
+    position_ = std::lower_bound(position_, excluded_.document_ids_.end(), document_id);
+    return position_ != excluded_.document_ids_.end() && *position_ == document_id;
+}
+
+void ExcludedDocuments::Build(const std::vector<const PostingList *> &minus_postings, int document_capacity, int plus_entry_count)
+{
+    ClearBitmap();
+    document_ids_.clear();
+
+    long long minus_document_count = 0;
+    for (const PostingList *postings : minus_postings)
+    {
+        minus_document_count += postings->GetDocumentCount();
+    }
+    if (minus_document_count == 0)
+    {
+        strategy_ = Strategy::NONE;
+        return;
+    }
+    strategy_ = minus_document_count * SORTED_LIST_RATIO <= plus_entry_count ? Strategy::SORTED_LIST : Strategy::BITMAP;
+
+    document_ids_.reserve(minus_document_count);
+    for (const PostingList *postings : minus_postings)
+    {
+        postings->ForEach([this](int document_id, int)
+                          { document_ids_.push_back(document_id); });
+    }
+    if (strategy_ == Strategy::SORTED_LIST)
+    {
+        std::sort(document_ids_.begin(), document_ids_.end());
+        document_ids_.erase(std::unique(document_ids_.begin(), document_ids_.end()), document_ids_.end());
+        return;
+    }
+    const std::size_t word_count = (document_capacity + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    if (bitmap_.size() < word_count)
+    {
+        bitmap_.resize(word_count, 0);
+    }
+    for (const int document_id : document_ids_)
+    {
+        bitmap_[document_id / BITS_PER_WORD] |= std::uint64_t{1} << (document_id % BITS_PER_WORD);
+    }
+}
+
+ExcludedDocuments::Strategy ExcludedDocuments::GetStrategy() const
+{
+    return strategy_;
+}
+
+ExcludedDocuments::Cursor ExcludedDocuments::MakeCursor() const
+{
+    return Cursor(*this);
+}
+
+void ExcludedDocuments::ClearBitmap()
+{
+    if (strategy_ != Strategy::BITMAP)
+    {
+        return;
+    }
+    for (const int document_id : document_ids_)
+    {
+        bitmap_[document_id / BITS_PER_WORD] = 0;
+    }
+}
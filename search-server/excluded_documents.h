@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+
+// документы с минус-словами запроса, собранные до подсчёта релевантности, чтобы не считать её зря.
+// Способ хранения выбирается по длинам списков документов: короткий отсортированный список
+// или битовая карта по внутренним номерам
+class ExcludedDocuments
+{
+public:
+    enum class Strategy
+    {
+        NONE,
+        SORTED_LIST,
+        BITMAP,
+    };
+
+    // проверка документов по возрастанию номера, как они идут в списке документов слова
+    class Cursor
+    {
+    public:
+        bool IsExcluded(int document_id);
+
+    private:
+        friend class ExcludedDocuments;
+        explicit Cursor(const ExcludedDocuments &excluded);
+
+        const ExcludedDocuments &excluded_;
+        std::vector<int>::const_iterator position_;
+    };
+
+    // собирает документы из списков минус-слов. document_capacity - граница внутренних номеров,
+    // plus_entry_count - сколько записей предстоит проверить в списках плюс-слов
+    void Build(const std::vector<const PostingList *> &minus_postings, int document_capacity, int plus_entry_count);
+
+    Strategy GetStrategy() const;
+
+    Cursor MakeCursor() const;
+
+private:
+    // список выбираем, если минус-документов не больше 1/SORTED_LIST_RATIO от проверяемых записей:
+    // двоичный поиск по короткому списку, лежащему в кэше, дешевле заполнения и чтения битовой карты
+    static constexpr long long SORTED_LIST_RATIO = 64;
+    static constexpr int BITS_PER_WORD = 64;
+
+    Strategy strategy_ = Strategy::NONE;
+    // при SORTED_LIST - номера по возрастанию без повторов, при BITMAP - номера выставленных битов для очистки
+    std::vector<int> document_ids_;
+    std::vector<std::uint64_t> bitmap_;
+
+    // обнуляет только биты, выставленные предыдущим Build
+    void ClearBitmap();
+};
@@ -0,0 +1,154 @@
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::literals::string_literals;
+
+MappedFile::MappedFile(const std::string &path)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error("Could not open index file "s + path);
+    }
+    struct stat file_status;
+    if (fstat(descriptor, &file_status) != 0)
+    {
+        close(descriptor);
+        throw std::runtime_error("Could not read size of index file "s + path);
+    }
+    size_ = static_cast<std::size_t>(file_status.st_size);
+    if (size_ > 0)
+    {
+        void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(descriptor);
+            throw std::runtime_error("Could not map index file "s + path);
+        }
+        data_ = static_cast<const char *>(mapping);
+    }
+    // отображение остаётся действительным и после закрытия дескриптора
+    close(descriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+const char *MappedFile::GetData() const
+{
+    return data_;
+}
+
+std::size_t MappedFile::GetSize() const
+{
+    return size_;
+}
+
+void SyncPath(const std::string &path)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error("Could not open "s + path + " to sync it"s);
+    }
+    const int result = fsync(descriptor);
+    close(descriptor);
+    if (result != 0)
+    {
+        throw std::runtime_error("Could not sync "s + path);
+    }
+}
+
+IndexWriter::IndexWriter(const std::string &path) : out_(path, std::ios::binary | std::ios::trunc)
+{
+    if (!out_)
+    {
+        throw std::runtime_error("Could not create index file "s + path);
+    }
+}
+
+void IndexWriter::WriteStrings(const std::vector<std::string_view> &strings)
+{
+    // строки одним массивом символов и массив смещений, строка i - [offsets[i], offsets[i + 1])
+    std::vector<std::uint64_t> offsets {0};
+    std::vector<char> characters;
+    for (const std::string_view str : strings)
+    {
+        characters.insert(characters.end(), str.begin(), str.end());
+        offsets.push_back(characters.size());
+    }
+    WriteArray(offsets);
+    WriteArray(characters);
+}
+
+void IndexWriter::Finish()
+{
+    out_.flush();
+    if (!out_)
+    {
+        throw std::runtime_error("Could not write index file"s);
+    }
+}
+
+void IndexWriter::WriteBytes(const void *data, std::size_t size)
+{
+    out_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    position_ += size;
+}
+
+void IndexWriter::Align()
+{
+    static const char padding[ARRAY_ALIGNMENT] = {};
+    WriteBytes(padding, (ARRAY_ALIGNMENT - position_ % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT);
+}
+
+IndexReader::IndexReader(const MappedFile &file) : data_(file.GetData()), size_(file.GetSize())
+{
+}
+
+std::vector<std::string_view> IndexReader::ReadStrings()
+{
+    const MappedVector<std::uint64_t> offsets = ReadArray<std::uint64_t>();
+    const MappedVector<char> characters = ReadArray<char>();
+    if (offsets.empty() || offsets.back() > characters.size())
+    {
+        throw std::runtime_error("Index file has broken string table"s);
+    }
+    std::vector<std::string_view> strings;
+    strings.reserve(offsets.size() - 1);
+    for (std::size_t i = 0; i + 1 < offsets.size(); ++i)
+    {
+        if (offsets[i] > offsets[i + 1])
+        {
+            throw std::runtime_error("Index file has broken string table"s);
+        }
+        strings.emplace_back(characters.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return strings;
+}
+
+const char *IndexReader::Take(std::size_t size)
+{
+    if (size > size_ - position_)
+    {
+        throw std::runtime_error("Index file is truncated"s);
+    }
+    const char *data = data_ + position_;
+    position_ += size;
+    return data;
+}
+
+void IndexReader::Align()
+{
+    const std::size_t padding = (ARRAY_ALIGNMENT - position_ % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT;
+    Take(std::min(padding, size_ - position_));
+}
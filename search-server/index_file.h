@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_vector.h"
+
+// файл индекса, отображённый в память только для чтения; отображение живёт, пока жив объект
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const;
+    std::size_t GetSize() const;
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// сбрасывает на диск файл или каталог, бросает std::runtime_error при ошибке
+void SyncPath(const std::string& path);
+
+// запись файла индекса: значения подряд в порядке записи, массивы выровнены на 8 байт,
+// чтобы их можно было читать прямо из отображённой памяти. Порядок байт - как у машины
+class IndexWriter
+{
+public:
+    explicit IndexWriter(const std::string& path);
+
+    template <typename T>
+    void Write(const T& value);
+
+    template <typename T>
+    void WriteArray(const T* data, std::size_t size);
+
+    template <typename T>
+    void WriteArray(const MappedVector<T>& values);
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& values);
+
+    void WriteStrings(const std::vector<std::string_view>& strings);
+
+    // дописывает буферы на диск, бросает std::runtime_error при ошибке записи
+    void Finish();
+
+private:
+    static constexpr std::size_t ARRAY_ALIGNMENT = 8;
+
+    std::ofstream out_;
+    std::uint64_t position_ = 0;
+
+    void WriteBytes(const void* data, std::size_t size);
+    void Align();
+};
+
+// чтение файла, записанного IndexWriter, в том же порядке. Массивы не копируются, а смотрят в отображение.
+// При выходе за конец файла бросает std::runtime_error
+class IndexReader
+{
+public:
+    explicit IndexReader(const MappedFile& file);
+
+    template <typename T>
+    T Read();
+
+    template <typename T>
+    MappedVector<T> ReadArray();
+
+    std::vector<std::string_view> ReadStrings();
+
+private:
+    static constexpr std::size_t ARRAY_ALIGNMENT = 8;
+
+    const char* data_;
+    std::size_t size_;
+    std::size_t position_ = 0;
+
+    const char* Take(std::size_t size);
+    void Align();
+};
+
+template <typename T>
+void IndexWriter::Write(const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written to an index");
+    WriteBytes(&value, sizeof(T));
+}
+
+template <typename T>
+void IndexWriter::WriteArray(const T* data, std::size_t size)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written to an index");
+    Write(static_cast<std::uint64_t>(size));
+    Align();
+    WriteBytes(data, size * sizeof(T));
+}
+
+template <typename T>
+void IndexWriter::WriteArray(const MappedVector<T>& values)
+{
+    WriteArray(values.data(), values.size());
+}
+
+template <typename T>
+void IndexWriter::WriteArray(const std::vector<T>& values)
+{
+    WriteArray(values.data(), values.size());
+}
+
+template <typename T>
+T IndexReader::Read()
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read from an index");
+    T value;
+    std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+    return value;
+}
+
+template <typename T>
+MappedVector<T> IndexReader::ReadArray()
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read from an index");
+    const std::uint64_t size = Read<std::uint64_t>();
+    Align();
+    if (size > (size_ - position_) / sizeof(T))
+    {
+        throw std::runtime_error("Index file is truncated");
+    }
+    return MappedVector<T>::View(reinterpret_cast<const T*>(Take(size * sizeof(T))), size);
+}
@@ -4,15 +4,22 @@
 #include "tests.h"
 #include "test_example_functions.h"
 #include "remove_duplicates.h"
+#include "benchmarks.h"
 
 using namespace std::literals::string_literals;
 
 
 
 
-int main() {
+int main(int argc, char* argv[]) {
     Tests tests;
     tests.TestSearchServer();
+    // замеры производительности долгие, запускаем их только по запросу: ./search_server bench
+    if (argc > 1 && argv[1] == "bench"s)
+    {
+        RunBenchmarks(std::cout);
+        return 0;
+    }
     /*
     SearchServer search_server("and in at"s);
 
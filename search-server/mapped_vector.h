@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// массив, который либо владеет своими данными, либо смотрит в чужую память - отображённый в память
+// файл индекса. Чтение одинаковое в обоих случаях, а первое изменение копирует чужие данные к себе.
+// Изменять можно только через методы ниже, поэтому неизменяемый индекс из файла не копируется
+template <typename T>
+class MappedVector
+{
+public:
+    MappedVector() = default;
+
+    MappedVector(const MappedVector& other)
+        : owned_(other.owned_), data_(other.IsView() ? other.data_ : owned_.data()), size_(other.size_)
+    {
+    }
+
+    MappedVector(MappedVector&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedVector& operator=(const MappedVector& rhs)
+    {
+        if (this != &rhs)
+        {
+            MappedVector copy(rhs);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    MappedVector& operator=(MappedVector&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            const bool is_view = rhs.IsView();
+            owned_ = std::move(rhs.owned_);
+            data_ = is_view ? rhs.data_ : owned_.data();
+            size_ = rhs.size_;
+            rhs.Reset();
+        }
+        return *this;
+    }
+
+    // смотрит в [data, data + size); память должна жить дольше массива и всех его копий
+    static MappedVector View(const T* data, std::size_t size)
+    {
+        MappedVector view;
+        view.data_ = data;
+        view.size_ = size;
+        return view;
+    }
+
+    bool IsView() const
+    {
+        return data_ != owned_.data();
+    }
+
+    const T* data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    const T& operator[](std::size_t index) const
+    {
+        return data_[index];
+    }
+
+    const T& back() const
+    {
+        return data_[size_ - 1];
+    }
+
+    const T* begin() const
+    {
+        return data_;
+    }
+
+    const T* end() const
+    {
+        return data_ + size_;
+    }
+
+    // память, выделенная самим массивом; страницы файла сюда не входят
+    std::size_t capacity() const
+    {
+        return owned_.capacity();
+    }
+
+    T* MutableData()
+    {
+        MakeOwned();
+        return owned_.data();
+    }
+
+    void push_back(const T& value)
+    {
+        MakeOwned();
+        owned_.push_back(value);
+        Sync();
+    }
+
+    void append(const T* first, const T* last)
+    {
+        MakeOwned();
+        owned_.insert(owned_.end(), first, last);
+        Sync();
+    }
+
+    void resize(std::size_t size, const T& value = T())
+    {
+        MakeOwned();
+        owned_.resize(size, value);
+        Sync();
+    }
+
+    void clear()
+    {
+        owned_.clear();
+        Sync();
+    }
+
+    void shrink_to_fit()
+    {
+        if (!IsView())
+        {
+            owned_.shrink_to_fit();
+            Sync();
+        }
+    }
+
+private:
+    // отдельного флага нет: массив смотрит в чужую память, когда data_ указывает не в owned_.
+    // В заголовке списка документов четыре таких массива, и без флага он на 32 байта короче
+    std::vector<T> owned_;
+    const T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    void MakeOwned()
+    {
+        if (IsView())
+        {
+            owned_.assign(data_, data_ + size_);
+            Sync();
+        }
+    }
+
+    // вызывается, только когда массив владеет данными
+    void Sync()
+    {
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+    void Reset()
+    {
+        std::vector<T>().swap(owned_);
+        Sync();
+    }
+};
@@ -0,0 +1,525 @@
+#include "posting_list.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+    constexpr int BITS_PER_REMOVED_WORD = 64;
+
+    // float, не меньший value: оценка сверху не должна уменьшиться от округления
+    float RoundUp(double value)
+    {
+        const float rounded = static_cast<float>(value);
+        return rounded < value ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+    }
+}
+
+void PostingList::Add(int document_id, int term_count)
+{
+    Add(document_id, term_count, term_count);
+}
+
+void PostingList::Add(int document_id, int term_count, double term_frequency)
+{
+    const float max_term_frequency = RoundUp(term_frequency);
+    max_term_frequency_ = std::max(max_term_frequency_, max_term_frequency);
+    if (last_document_id_ < document_id)
+    {
+        Append(document_id, term_count, max_term_frequency);
+        return;
+    }
+    std::vector<std::uint32_t> document_ids;
+    std::vector<std::uint32_t> term_counts;
+    std::vector<float> term_frequencies;
+    DecodeAll(document_ids, term_counts, term_frequencies);
+    const auto it = std::lower_bound(document_ids.begin(), document_ids.end(), static_cast<std::uint32_t>(document_id));
+    const int entry = static_cast<int>(it - document_ids.begin());
+    if (it != document_ids.end() && *it == static_cast<std::uint32_t>(document_id))
+    {
+        // документ с таким id был удалён, но запись ещё не вычищена - переиспользуем её
+        if (IsRemoved(entry))
+        {
+            SetRemoved(entry, false);
+            --removed_count_;
+            term_counts[entry] = 0;
+            term_frequencies[entry] = 0;
+        }
+        term_counts[entry] += term_count;
+        term_frequencies[entry] = std::max(term_frequencies[entry], max_term_frequency);
+    }
+    else
+    {
+        document_ids.insert(it, document_id);
+        term_counts.insert(term_counts.begin() + entry, term_count);
+        term_frequencies.insert(term_frequencies.begin() + entry, max_term_frequency);
+        // пометки удаления после вставленной записи сдвигаются на одну
+        if (!removed_bits_.empty())
+        {
+            removed_bits_.resize(document_ids.size() / BITS_PER_REMOVED_WORD + 1, 0);
+            for (int i = static_cast<int>(document_ids.size()) - 1; i > entry; --i)
+            {
+                SetRemoved(i, IsRemoved(i - 1));
+            }
+            SetRemoved(entry, false);
+        }
+    }
+    Rebuild(document_ids, term_counts, term_frequencies);
+}
+
+void PostingList::Remove(int document_id)
+{
+    if (MarkRemoved(document_id))
+    {
+        CompactIfNeeded();
+    }
+}
+
+void PostingList::Remove(const std::vector<int> &document_ids)
+{
+    for (const int document_id : document_ids)
+    {
+        MarkRemoved(document_id);
+    }
+    CompactIfNeeded();
+}
+
+bool PostingList::MarkRemoved(int document_id)
+{
+    const int entry = FindEntry(document_id);
+    if (entry < 0 || IsRemoved(entry))
+    {
+        return false;
+    }
+    SetRemoved(entry, true);
+    ++removed_count_;
+    return true;
+}
+
+bool PostingList::Contains(int document_id) const
+{
+    const int entry = FindEntry(document_id);
+    return entry >= 0 && !IsRemoved(entry);
+}
+
+int PostingList::GetDocumentCount() const
+{
+    return GetEntryCount() - removed_count_;
+}
+
+bool PostingList::IsEmpty() const
+{
+    return GetDocumentCount() == 0;
+}
+
+int PostingList::GetEntryCount() const
+{
+    return GetPackedEntryCount() + tail_size_;
+}
+
+int PostingList::GetLastDocumentId() const
+{
+    return GetEntryCount() == 0 ? -1 : last_document_id_;
+}
+
+double PostingList::GetMaxTermFrequency() const
+{
+    return max_term_frequency_;
+}
+
+std::size_t PostingList::GetMemoryUsage() const
+{
+    return sizeof(PostingList) + blocks_.capacity() * sizeof(Block) + packed_.capacity() * sizeof(std::uint32_t)
+         + tail_.capacity() + removed_bits_.capacity() * sizeof(std::uint64_t);
+}
+
+void PostingList::Save(IndexWriter &writer) const
+{
+    writer.Write(tail_size_);
+    writer.Write(last_document_id_);
+    writer.Write(removed_count_);
+    writer.Write(tail_max_term_frequency_);
+    writer.Write(max_term_frequency_);
+    writer.WriteArray(blocks_);
+    writer.WriteArray(packed_);
+    writer.WriteArray(tail_);
+    writer.WriteArray(removed_bits_);
+}
+
+PostingList PostingList::Open(IndexReader &reader)
+{
+    PostingList posting_list;
+    posting_list.tail_size_ = reader.Read<int>();
+    posting_list.last_document_id_ = reader.Read<int>();
+    posting_list.removed_count_ = reader.Read<int>();
+    posting_list.tail_max_term_frequency_ = reader.Read<float>();
+    posting_list.max_term_frequency_ = reader.Read<float>();
+    posting_list.blocks_ = reader.ReadArray<Block>();
+    posting_list.packed_ = reader.ReadArray<std::uint32_t>();
+    posting_list.tail_ = reader.ReadArray<std::uint8_t>();
+    posting_list.removed_bits_ = reader.ReadArray<std::uint64_t>();
+    posting_list.CheckOpened();
+    return posting_list;
+}
+
+void PostingList::CheckOpened() const
+{
+    const auto check = [](bool condition)
+    {
+        if (!condition)
+        {
+            throw std::runtime_error("Index file has a broken posting list"s);
+        }
+    };
+    check(tail_size_ >= 0 && tail_size_ < PACKED_BLOCK_SIZE);
+    check(static_cast<std::int64_t>(blocks_.size()) * PACKED_BLOCK_SIZE + tail_size_ <= std::numeric_limits<int>::max());
+    check(removed_count_ >= 0 && removed_count_ <= GetEntryCount());
+
+    // каждый id распаковывается один раз: id строго растут и помещаются в int, а последние id блоков
+    // и списка совпадают с распакованными. Тогда граница GetLastDocumentId верна для всех записей
+    std::uint32_t document_ids[PACKED_BLOCK_SIZE];
+    std::uint32_t term_counts[PACKED_BLOCK_SIZE];
+    std::int64_t previous_document_id = -1;
+    const auto check_increasing = [&](int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            check(document_ids[i] > previous_document_id && document_ids[i] <= static_cast<std::uint32_t>(std::numeric_limits<int>::max()));
+            previous_document_id = document_ids[i];
+        }
+    };
+    for (int block_index = 0; block_index < static_cast<int>(blocks_.size()); ++block_index)
+    {
+        // распаковка блока читает его слова без проверок, поэтому смещение и ширины проверяются до неё
+        const Block &block = blocks_[block_index];
+        check(block.document_id_bit_width <= 32 && block.term_count_bit_width <= 32);
+        const std::size_t word_count = GetPackedWordCount(block.document_id_bit_width) + GetPackedWordCount(block.term_count_bit_width);
+        check(block.offset <= packed_.size() && word_count <= packed_.size() - block.offset);
+        DecodeBlock(block_index, document_ids, term_counts);
+        check_increasing(PACKED_BLOCK_SIZE);
+        check(previous_document_id == block.last_document_id);
+    }
+
+    // хвост - ровно 2 * tail_size_ чисел переменной длины не длиннее MAX_VARINT_SIZE байт:
+    // ReadVarint длину не проверяет
+    int varint_count = 0;
+    int varint_size = 0;
+    for (const std::uint8_t byte : tail_)
+    {
+        ++varint_size;
+        check(varint_size <= MAX_VARINT_SIZE);
+        if ((byte & 0x80) == 0)
+        {
+            ++varint_count;
+            varint_size = 0;
+        }
+    }
+    check(varint_count == 2 * tail_size_ && varint_size == 0);
+    DecodeTail(document_ids, term_counts);
+    check_increasing(tail_size_);
+    check(GetEntryCount() == 0 || previous_document_id == last_document_id_);
+}
+
+int PostingList::GetPackedEntryCount() const
+{
+    return static_cast<int>(blocks_.size()) * PACKED_BLOCK_SIZE;
+}
+
+bool PostingList::IsRemoved(int entry) const
+{
+    // пометки заведены только до последней помеченной записи
+    const std::size_t word = entry / BITS_PER_REMOVED_WORD;
+    return removed_count_ > 0 && word < removed_bits_.size() && (removed_bits_[word] >> (entry % BITS_PER_REMOVED_WORD)) & 1;
+}
+
+void PostingList::SetRemoved(int entry, bool is_removed)
+{
+    // место под пометки растёт вместе со списком только после первого удаления
+    if (static_cast<int>(removed_bits_.size()) * BITS_PER_REMOVED_WORD <= entry)
+    {
+        removed_bits_.resize(entry / BITS_PER_REMOVED_WORD + 1, 0);
+    }
+    const std::uint64_t bit = std::uint64_t{1} << (entry % BITS_PER_REMOVED_WORD);
+    std::uint64_t &word = removed_bits_.MutableData()[entry / BITS_PER_REMOVED_WORD];
+    word = is_removed ? word | bit : word & ~bit;
+}
+
+void PostingList::DecodeBlock(int block_index, std::uint32_t *document_ids, std::uint32_t *term_counts) const
+{
+    const Block &block = blocks_[block_index];
+    const std::uint32_t base = block_index == 0 ? 0 : blocks_[block_index - 1].last_document_id;
+    const std::uint32_t *packed = packed_.data() + block.offset;
+    UnpackBlock(packed, block.document_id_bit_width, document_ids);
+    DecodeDeltas(document_ids, base);
+    UnpackBlock(packed + GetPackedWordCount(block.document_id_bit_width), block.term_count_bit_width, term_counts);
+}
+
+void PostingList::DecodeTail(std::uint32_t *document_ids, std::uint32_t *term_counts) const
+{
+    const std::uint8_t *data = tail_.data();
+    std::uint32_t document_id = blocks_.empty() ? 0 : blocks_.back().last_document_id;
+    for (int i = 0; i < tail_size_; ++i)
+    {
+        document_id += ReadVarint(data);
+        document_ids[i] = document_id;
+        term_counts[i] = ReadVarint(data) + 1;
+    }
+}
+
+void PostingList::AppendBlock(const std::uint32_t *document_ids, const std::uint32_t *term_counts, float max_term_frequency)
+{
+    std::uint32_t deltas[PACKED_BLOCK_SIZE];
+    std::uint32_t values[PACKED_BLOCK_SIZE];
+    EncodeDeltas(document_ids, blocks_.empty() ? 0 : blocks_.back().last_document_id, deltas);
+    // число вхождений не меньше единицы, храним на единицу меньше - у редких слов это одни нули
+    std::transform(term_counts, term_counts + PACKED_BLOCK_SIZE, values, [](std::uint32_t term_count)
+                   { return term_count - 1; });
+
+    Block block;
+    block.last_document_id = static_cast<int>(document_ids[PACKED_BLOCK_SIZE - 1]);
+    block.offset = static_cast<std::uint32_t>(packed_.size());
+    block.max_term_frequency = max_term_frequency;
+    block.document_id_bit_width = static_cast<std::uint8_t>(GetRequiredBitWidth(deltas));
+    block.term_count_bit_width = static_cast<std::uint8_t>(GetRequiredBitWidth(values));
+    const int document_id_word_count = GetPackedWordCount(block.document_id_bit_width);
+    packed_.resize(packed_.size() + document_id_word_count + GetPackedWordCount(block.term_count_bit_width));
+    std::uint32_t *packed = packed_.MutableData() + block.offset;
+    PackBlock(deltas, block.document_id_bit_width, packed);
+    PackBlock(values, block.term_count_bit_width, packed + document_id_word_count);
+    blocks_.push_back(block);
+}
+
+void PostingList::Append(int document_id, int term_count, float term_frequency)
+{
+    const int previous_document_id = tail_size_ > 0 || !blocks_.empty() ? last_document_id_ : 0;
+    std::uint8_t bytes[2 * MAX_VARINT_SIZE];
+    int size = EncodeVarint(static_cast<std::uint32_t>(document_id - previous_document_id), bytes);
+    size += EncodeVarint(static_cast<std::uint32_t>(term_count - 1), bytes + size);
+    tail_.append(bytes, bytes + size);
+    ++tail_size_;
+    last_document_id_ = document_id;
+    tail_max_term_frequency_ = std::max(tail_max_term_frequency_, term_frequency);
+    if (tail_size_ == PACKED_BLOCK_SIZE)
+    {
+        std::uint32_t document_ids[PACKED_BLOCK_SIZE];
+        std::uint32_t term_counts[PACKED_BLOCK_SIZE];
+        DecodeTail(document_ids, term_counts);
+        AppendBlock(document_ids, term_counts, tail_max_term_frequency_);
+        tail_.clear();
+        tail_size_ = 0;
+        tail_max_term_frequency_ = 0;
+    }
+}
+
+int PostingList::FindEntry(int document_id) const
+{
+    if (document_id > last_document_id_ || document_id < 0)
+    {
+        return -1;
+    }
+    std::uint32_t document_ids[PACKED_BLOCK_SIZE];
+    std::uint32_t term_counts[PACKED_BLOCK_SIZE];
+    const std::uint32_t id = static_cast<std::uint32_t>(document_id);
+    if (blocks_.empty() || blocks_.back().last_document_id < document_id)
+    {
+        DecodeTail(document_ids, term_counts);
+        const std::uint32_t *it = std::lower_bound(document_ids, document_ids + tail_size_, id);
+        return it != document_ids + tail_size_ && *it == id ? GetPackedEntryCount() + static_cast<int>(it - document_ids) : -1;
+    }
+    // блок, в котором мог бы лежать документ, - первый с последним id не меньше искомого
+    const auto block_it = std::lower_bound(blocks_.begin(), blocks_.end(), document_id, [](const Block &block, int id)
+                                           { return block.last_document_id < id; });
+    const int block_index = static_cast<int>(block_it - blocks_.begin());
+    DecodeBlock(block_index, document_ids, term_counts);
+    const std::uint32_t *it = std::lower_bound(document_ids, document_ids + PACKED_BLOCK_SIZE, id);
+    return *it == id ? block_index * PACKED_BLOCK_SIZE + static_cast<int>(it - document_ids) : -1;
+}
+
+void PostingList::DecodeAll(std::vector<std::uint32_t> &document_ids, std::vector<std::uint32_t> &term_counts,
+                            std::vector<float> &term_frequencies) const
+{
+    document_ids.resize(GetEntryCount());
+    term_counts.resize(GetEntryCount());
+    term_frequencies.resize(GetEntryCount());
+    for (int block_index = 0; block_index < static_cast<int>(blocks_.size()); ++block_index)
+    {
+        const int first = block_index * PACKED_BLOCK_SIZE;
+        DecodeBlock(block_index, document_ids.data() + first, term_counts.data() + first);
+        std::for_each(term_counts.begin() + first, term_counts.begin() + first + PACKED_BLOCK_SIZE, [](std::uint32_t &term_count)
+                      { ++term_count; });
+        std::fill(term_frequencies.begin() + first, term_frequencies.begin() + first + PACKED_BLOCK_SIZE, blocks_[block_index].max_term_frequency);
+    }
+    DecodeTail(document_ids.data() + GetPackedEntryCount(), term_counts.data() + GetPackedEntryCount());
+    std::fill(term_frequencies.begin() + GetPackedEntryCount(), term_frequencies.end(), tail_max_term_frequency_);
+}
+
+void PostingList::Rebuild(const std::vector<std::uint32_t> &document_ids, const std::vector<std::uint32_t> &term_counts,
+                          const std::vector<float> &term_frequencies)
+{
+    blocks_.clear();
+    packed_.clear();
+    tail_.clear();
+    tail_size_ = 0;
+    tail_max_term_frequency_ = 0;
+    last_document_id_ = -1;
+    const int entry_count = static_cast<int>(document_ids.size());
+    const int packed_entry_count = entry_count - entry_count % PACKED_BLOCK_SIZE;
+    for (int first = 0; first < packed_entry_count; first += PACKED_BLOCK_SIZE)
+    {
+        AppendBlock(document_ids.data() + first, term_counts.data() + first,
+                    *std::max_element(term_frequencies.begin() + first, term_frequencies.begin() + first + PACKED_BLOCK_SIZE));
+        last_document_id_ = blocks_.back().last_document_id;
+    }
+    for (int i = packed_entry_count; i < entry_count; ++i)
+    {
+        Append(static_cast<int>(document_ids[i]), static_cast<int>(term_counts[i]), term_frequencies[i]);
+    }
+}
+
+void PostingList::CompactIfNeeded()
+{
+    if (removed_count_ > 0 && 2 * removed_count_ >= GetEntryCount())
+    {
+        Compact();
+    }
+}
+
+void PostingList::Compact()
+{
+    std::vector<std::uint32_t> document_ids;
+    std::vector<std::uint32_t> term_counts;
+    std::vector<float> term_frequencies;
+    DecodeAll(document_ids, term_counts, term_frequencies);
+    int live_count = 0;
+    for (int entry = 0; entry < static_cast<int>(document_ids.size()); ++entry)
+    {
+        if (!IsRemoved(entry))
+        {
+            document_ids[live_count] = document_ids[entry];
+            term_counts[live_count] = term_counts[entry];
+            term_frequencies[live_count] = term_frequencies[entry];
+            ++live_count;
+        }
+    }
+    document_ids.resize(live_count);
+    term_counts.resize(live_count);
+    term_frequencies.resize(live_count);
+    removed_bits_.clear();
+    removed_bits_.shrink_to_fit();
+    removed_count_ = 0;
+    Rebuild(document_ids, term_counts, term_frequencies);
+}
+
+PostingList::Cursor::Cursor(const PostingList &postings) : postings_(&postings), entry_count_(postings.GetEntryCount())
+{
+    if (entry_count_ > 0)
+    {
+        LoadChunk(0);
+        SkipRemoved();
+    }
+}
+
+void PostingList::Cursor::Next()
+{
+    ++entry_;
+    if (entry_ == chunk_first_ + chunk_size_ && !IsEnd())
+    {
+        LoadChunk(entry_ / PACKED_BLOCK_SIZE);
+    }
+    SkipRemoved();
+}
+
+void PostingList::Cursor::Advance(int document_id)
+{
+    if (IsEnd() || GetDocumentId() >= document_id)
+    {
+        return;
+    }
+    if (document_id > postings_->last_document_id_)
+    {
+        entry_ = entry_count_;
+        return;
+    }
+    if (static_cast<int>(document_ids_[chunk_size_ - 1]) < document_id)
+    {
+        // нужный блок - первый с последним id не меньше искомого; если такого нет, документ в хвосте
+        const auto &blocks = postings_->blocks_;
+        const auto block_it = std::lower_bound(blocks.begin() + (chunk_first_ / PACKED_BLOCK_SIZE + 1), blocks.end(), document_id,
+                                               [](const Block &block, int id)
+                                               { return block.last_document_id < id; });
+        LoadChunk(static_cast<int>(block_it - blocks.begin()));
+        entry_ = chunk_first_;
+    }
+    std::uint32_t *first = document_ids_ + (entry_ - chunk_first_);
+    entry_ = chunk_first_ + static_cast<int>(std::lower_bound(first, document_ids_ + chunk_size_, static_cast<std::uint32_t>(document_id)) - document_ids_);
+    SkipRemoved();
+}
+
+int PostingList::Cursor::GetBlockLastDocumentId() const
+{
+    return static_cast<int>(document_ids_[chunk_size_ - 1]);
+}
+
+double PostingList::Cursor::GetBlockMaxTermFrequency() const
+{
+    const int block_index = chunk_first_ / PACKED_BLOCK_SIZE;
+    return block_index < static_cast<int>(postings_->blocks_.size()) ? postings_->blocks_[block_index].max_term_frequency
+                                                                     : postings_->tail_max_term_frequency_;
+}
+
+double PostingList::Cursor::GetMaxTermFrequencyAt(int document_id) const
+{
+    if (IsEnd() || document_id > postings_->last_document_id_)
+    {
+        return 0;
+    }
+    if (document_id <= GetBlockLastDocumentId())
+    {
+        return GetBlockMaxTermFrequency();
+    }
+    const auto &blocks = postings_->blocks_;
+    const auto block_it = std::lower_bound(blocks.begin() + (chunk_first_ / PACKED_BLOCK_SIZE + 1), blocks.end(), document_id,
+                                           [](const Block &block, int id)
+                                           { return block.last_document_id < id; });
+    return block_it != blocks.end() ? block_it->max_term_frequency : postings_->tail_max_term_frequency_;
+}
+
+void PostingList::Cursor::LoadChunk(int block_index)
+{
+    if (block_index < static_cast<int>(postings_->blocks_.size()))
+    {
+        postings_->DecodeBlock(block_index, document_ids_, term_counts_);
+        for (std::uint32_t &term_count : term_counts_)
+        {
+            ++term_count;
+        }
+        chunk_first_ = block_index * PACKED_BLOCK_SIZE;
+        chunk_size_ = PACKED_BLOCK_SIZE;
+    }
+    else
+    {
+        postings_->DecodeTail(document_ids_, term_counts_);
+        chunk_first_ = postings_->GetPackedEntryCount();
+        chunk_size_ = postings_->tail_size_;
+    }
+}
+
+void PostingList::Cursor::SkipRemoved()
+{
+    if (postings_->removed_count_ == 0)
+    {
+        return;
+    }
+    while (!IsEnd() && postings_->IsRemoved(entry_))
+    {
+        ++entry_;
+        if (entry_ == chunk_first_ + chunk_size_ && !IsEnd())
+        {
+            LoadChunk(entry_ / PACKED_BLOCK_SIZE);
+        }
+    }
+}
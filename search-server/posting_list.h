@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bit_packing.h"
+#include "mapped_vector.h"
+#include "index_file.h"
+
+// список документов, содержащих слово: id документов по возрастанию и число вхождений слова в каждый.
+// Полные блоки по 128 записей хранятся упакованными: id - разностями в общей для блока ширине бит,
+// число вхождений - тоже упакованным (обычно это единицы, и блок на них почти не тратит места).
+// Записи, которым не хватило на блок, лежат в хвосте разностями и числами переменной длины.
+// Удаление ленивое - запись помечается, а список пересобирается, когда помеченных становится много.
+// У каждого блока и у хвоста хранится оценка сверху TF их документов: по ней поиск лучших пропускает
+// блоки, которые не могут поднять документ выше порога
+class PostingList
+{
+public:
+    // добавляет документ с числом вхождений слова; быстрее всего, когда id больше всех уже добавленных.
+    // term_frequency - TF слова в документе для оценок блоков; без него оценкой служит само число вхождений,
+    // ведь TF = число вхождений / число слов документа
+    void Add(int document_id, int term_count);
+    void Add(int document_id, int term_count, double term_frequency);
+
+    void Remove(int document_id);
+
+    // удаляет сразу несколько документов; id должны идти по возрастанию
+    void Remove(const std::vector<int>& document_ids);
+
+    bool Contains(int document_id) const;
+
+    // число документов, которые не удалены
+    int GetDocumentCount() const;
+
+    bool IsEmpty() const;
+
+    // число записей вместе с ещё не вычищенными удалёнными - граница для ForEachInRange
+    int GetEntryCount() const;
+
+    // наибольший id среди записей, в том числе удалённых; -1, если записей нет
+    int GetLastDocumentId() const;
+
+    // оценка сверху TF по всему списку; удаление её не уменьшает
+    double GetMaxTermFrequency() const;
+
+    // сколько байт занимает список вместе с выделенной под него памятью; страницы файла индекса не считаются
+    std::size_t GetMemoryUsage() const;
+
+    // запись в файл индекса и чтение из него: прочитанный список смотрит в отображённый файл,
+    // пока его не изменят. Open один раз распаковывает все записи и бросает std::runtime_error, если блоки
+    // или хвост выходят за свои массивы или id не растут строго; после этого все id не больше GetLastDocumentId
+    void Save(IndexWriter& writer) const;
+    static PostingList Open(IndexReader& reader);
+
+    // линейный проход по неудалённым документам, func(document_id, term_count)
+    template <typename Function>
+    void ForEach(Function func) const;
+
+    // то же для записей с номерами [first, last), позволяет делить список между потоками
+    template <typename Function>
+    void ForEachInRange(int first, int last, Function func) const;
+
+    // проход по неудалённым документам с пропусками: Advance перескакивает блоки по их последнему id,
+    // не распаковывая их. Распакован только блок (или хвост), в котором стоит курсор
+    class Cursor
+    {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool IsEnd() const
+        {
+            return entry_ >= entry_count_;
+        }
+
+        int GetDocumentId() const
+        {
+            return static_cast<int>(document_ids_[entry_ - chunk_first_]);
+        }
+
+        int GetTermCount() const
+        {
+            return static_cast<int>(term_counts_[entry_ - chunk_first_]);
+        }
+
+        void Next();
+
+        // встаёт на первый документ с id не меньше document_id; назад не ходит
+        void Advance(int document_id);
+
+        // последний id и оценка TF блока (или хвоста), в котором стоит курсор
+        int GetBlockLastDocumentId() const;
+        double GetBlockMaxTermFrequency() const;
+
+        // оценка TF блока, в котором лежал бы документ document_id, не меньшего текущего; ничего не распаковывает
+        double GetMaxTermFrequencyAt(int document_id) const;
+
+    private:
+        const PostingList* postings_;
+        int entry_ = 0;
+        int entry_count_;
+        // распакованный кусок: записи [chunk_first_, chunk_first_ + chunk_size_)
+        int chunk_first_ = 0;
+        int chunk_size_ = 0;
+        std::uint32_t document_ids_[PACKED_BLOCK_SIZE];
+        // настоящие числа вхождений, без вычитания единицы
+        std::uint32_t term_counts_[PACKED_BLOCK_SIZE];
+
+        // распаковывает блок с номером block_index или хвост, если блоков столько нет
+        void LoadChunk(int block_index);
+        // сдвигается с удалённых записей вперёд
+        void SkipRemoved();
+    };
+
+private:
+    struct Block
+    {
+        // от него считаются разности следующего блока
+        int last_document_id;
+        std::uint32_t offset;
+        // оценка сверху TF документов блока, округлена вверх до float
+        float max_term_frequency;
+        std::uint8_t document_id_bit_width;
+        std::uint8_t term_count_bit_width;
+    };
+
+    MappedVector<Block> blocks_;
+    // упакованные блоки подряд: сначала разности id, затем числа вхождений минус один
+    MappedVector<std::uint32_t> packed_;
+    // хвост: пары (разность с предыдущим id, число вхождений минус один)
+    MappedVector<std::uint8_t> tail_;
+    int tail_size_ = 0;
+    int last_document_id_ = -1;
+    float tail_max_term_frequency_ = 0;
+    float max_term_frequency_ = 0;
+    // пометки удаления по номеру записи, заводятся при первом удалении
+    MappedVector<std::uint64_t> removed_bits_;
+    int removed_count_ = 0;
+
+    int GetPackedEntryCount() const;
+    // проверки списка, прочитанного из файла
+    void CheckOpened() const;
+    bool IsRemoved(int entry) const;
+    void SetRemoved(int entry, bool is_removed);
+
+    void DecodeBlock(int block_index, std::uint32_t* document_ids, std::uint32_t* term_counts) const;
+    // распаковывает хвост, числа вхождений - уже настоящие
+    void DecodeTail(std::uint32_t* document_ids, std::uint32_t* term_counts) const;
+    void AppendBlock(const std::uint32_t* document_ids, const std::uint32_t* term_counts, float max_term_frequency);
+    // дописывает запись в конец, упаковывая хвост, когда он дорастает до блока
+    void Append(int document_id, int term_count, float term_frequency);
+
+    // номер записи документа или -1
+    int FindEntry(int document_id) const;
+    // помечает запись удалённой, возвращает false, если документа в списке нет
+    bool MarkRemoved(int document_id);
+
+    // изменения середины списка делаются через полную распаковку и пересборку.
+    // TF отдельных записей не хранятся, поэтому запись уносит с собой оценку своего блока
+    void DecodeAll(std::vector<std::uint32_t>& document_ids, std::vector<std::uint32_t>& term_counts,
+                   std::vector<float>& term_frequencies) const;
+    void Rebuild(const std::vector<std::uint32_t>& document_ids, const std::vector<std::uint32_t>& term_counts,
+                 const std::vector<float>& term_frequencies);
+
+    // пересобираем без удалённых, когда их становится не меньше половины
+    void CompactIfNeeded();
+    void Compact();
+};
+
+template <typename Function>
+void PostingList::ForEach(Function func) const
+{
+    ForEachInRange(0, GetEntryCount(), func);
+}
+
+template <typename Function>
+void PostingList::ForEachInRange(int first, int last, Function func) const
+{
+    const int packed_entry_count = GetPackedEntryCount();
+    std::uint32_t document_ids[PACKED_BLOCK_SIZE];
+    std::uint32_t term_counts[PACKED_BLOCK_SIZE];
+    int entry = first;
+    while (entry < std::min(last, packed_entry_count))
+    {
+        const int block_index = entry / PACKED_BLOCK_SIZE;
+        DecodeBlock(block_index, document_ids, term_counts);
+        const int block_last = std::min(last, (block_index + 1) * PACKED_BLOCK_SIZE);
+        for (; entry < block_last; ++entry)
+        {
+            if (!IsRemoved(entry))
+            {
+                const int i = entry % PACKED_BLOCK_SIZE;
+                func(static_cast<int>(document_ids[i]), static_cast<int>(term_counts[i]) + 1);
+            }
+        }
+    }
+    if (entry >= last)
+    {
+        return;
+    }
+    DecodeTail(document_ids, term_counts);
+    for (; entry < last; ++entry)
+    {
+        if (!IsRemoved(entry))
+        {
+            const int i = entry - packed_entry_count;
+            func(static_cast<int>(document_ids[i]), static_cast<int>(term_counts[i]));
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#include "process_queries.h"
+
+#include <algorithm>
+#include <execution>
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer &search_server, const std::vector<std::string> &queries)
+{
+    std::vector<std::vector<Document>> results(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), results.begin(),
+                   [&search_server](const std::string &query)
+                   { return search_server.FindTopDocuments(query); });
+    return results;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries)
+{
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
+
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> results) : results_(std::move(results))
+{
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const
+{
+    return Iterator(results_.data(), results_.size(), 0);
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const
+{
+    return Iterator(results_.data(), results_.size(), results_.size());
+}
+
+std::size_t JoinedDocuments::size() const
+{
+    std::size_t size = 0;
+    for (const std::vector<Document> &documents : results_)
+    {
+        size += documents.size();
+    }
+    return size;
+}
+
+// итератор хранит указатель на данные внешнего вектора, они переживают перемещение JoinedDocuments
+JoinedDocuments::Iterator::Iterator(const std::vector<Document> *results, std::size_t query_count, std::size_t query_index)
+    : results_(results), query_count_(query_count), query_index_(query_index)
+{
+    SkipEmptyResults();
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const
+{
+    return results_[query_index_][document_index_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const
+{
+    return &**this;
+}
+
+JoinedDocuments::Iterator &JoinedDocuments::Iterator::operator++()
+{
+    if (++document_index_ == results_[query_index_].size())
+    {
+        ++query_index_;
+        document_index_ = 0;
+        SkipEmptyResults();
+    }
+    return *this;
+}
+
+JoinedDocuments::Iterator JoinedDocuments::Iterator::operator++(int)
+{
+    Iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator &rhs) const
+{
+    return results_ == rhs.results_ && query_index_ == rhs.query_index_ && document_index_ == rhs.document_index_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator &rhs) const
+{
+    return !(*this == rhs);
+}
+
+void JoinedDocuments::Iterator::SkipEmptyResults()
+{
+    while (query_index_ < query_count_ && results_[query_index_].empty())
+    {
+        ++query_index_;
+    }
+}
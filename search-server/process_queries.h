@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// выполняет запросы параллельно, i-й элемент результата - выдача FindTopDocuments для i-го запроса
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+// выдачи всех запросов подряд, без копирования в один общий вектор
+class JoinedDocuments
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator(const std::vector<Document>* results, std::size_t query_count, std::size_t query_index);
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+
+    private:
+        const std::vector<Document>* results_;
+        std::size_t query_count_;
+        std::size_t query_index_;
+        std::size_t document_index_ = 0;
+
+        // пропускает запросы с пустой выдачей
+        void SkipEmptyResults();
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> results);
+
+    Iterator begin() const;
+    Iterator end() const;
+    std::size_t size() const;
+
+private:
+    std::vector<std::vector<Document>> results_;
+};
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
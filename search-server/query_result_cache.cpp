@@ -0,0 +1,93 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(const SearchServer &search_server, std::size_t memory_budget)
+    : search_server_(search_server), memory_budget_(memory_budget), epoch_(search_server.GetEpoch())
+{
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count)
+{
+    std::string filter_key(1, 's');
+    filter_key += static_cast<char>(status);
+    return FindOrSearch(MakeKey(raw_query, filter_key, max_result_count), [&]
+                        { return search_server_.FindTopDocuments(raw_query, status, max_result_count); });
+}
+
+std::uint64_t QueryResultCache::GetHitCount() const
+{
+    std::lock_guard guard(mutex_);
+    return hit_count_;
+}
+
+std::uint64_t QueryResultCache::GetMissCount() const
+{
+    std::lock_guard guard(mutex_);
+    return miss_count_;
+}
+
+std::size_t QueryResultCache::GetMemoryUsage() const
+{
+    std::lock_guard guard(mutex_);
+    return memory_usage_;
+}
+
+std::string QueryResultCache::MakeKey(std::string_view raw_query, std::string_view filter_key, int max_result_count) const
+{
+    // разбор запроса бросает invalid_argument раньше, чем мы что-то запомним
+    std::string key = search_server_.GetQueryKey(raw_query);
+    key.append(reinterpret_cast<const char *>(&max_result_count), sizeof(max_result_count));
+    key += filter_key;
+    return key;
+}
+
+bool QueryResultCache::Find(const std::string &key, std::vector<Document> &documents)
+{
+    std::lock_guard guard(mutex_);
+    CheckEpoch();
+    const auto it = key_to_entry_.find(key);
+    if (it == key_to_entry_.end())
+    {
+        ++miss_count_;
+        return false;
+    }
+    ++hit_count_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    documents = it->second->documents;
+    return true;
+}
+
+void QueryResultCache::Insert(std::string key, const std::vector<Document> &documents)
+{
+    // запись, список и узел таблицы; точный размер узлов зависит от библиотеки, считаем по три указателя
+    const std::size_t size = sizeof(Entry) + 3 * sizeof(void *) + sizeof(std::pair<std::string_view, void *>) + 3 * sizeof(void *)
+                           + key.size() + documents.size() * sizeof(Document);
+    std::lock_guard guard(mutex_);
+    CheckEpoch();
+    if (size > memory_budget_ || key_to_entry_.count(key) > 0)
+    {
+        return;
+    }
+    while (memory_usage_ + size > memory_budget_)
+    {
+        const Entry &oldest = entries_.back();
+        memory_usage_ -= oldest.size;
+        key_to_entry_.erase(oldest.key);
+        entries_.pop_back();
+    }
+    entries_.push_front({std::move(key), documents, size});
+    // ключ таблицы смотрит в строку записи, узлы списка не переезжают
+    key_to_entry_.emplace(entries_.front().key, entries_.begin());
+    memory_usage_ += size;
+}
+
+void QueryResultCache::CheckEpoch()
+{
+    const std::uint64_t epoch = search_server_.GetEpoch();
+    if (epoch != epoch_)
+    {
+        entries_.clear();
+        key_to_entry_.clear();
+        memory_usage_ = 0;
+        epoch_ = epoch;
+    }
+}
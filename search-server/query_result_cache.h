@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+#include "document.h"
+
+// LRU-кэш ответов FindTopDocuments. Ключ - нормализованный запрос (SearchServer::GetQueryKey), статус
+// или имя фильтра и число результатов, поэтому "cat dog", "dog  cat" и "dog cat the" делят одну запись.
+// Когда эпоха сервера меняется, кэш очищается целиком. Можно вызывать из нескольких потоков,
+// пока сервер не меняется
+class QueryResultCache
+{
+public:
+    // memory_budget - сколько байт могут занимать записи кэша
+    QueryResultCache(const SearchServer& search_server, std::size_t memory_budget);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    // фильтр нельзя сравнить с другим, поэтому его называет вызывающий: одинаковые имена - одинаковые фильтры
+    template <typename Filter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, std::string_view filter_name, Filter filtering_predicat,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    std::uint64_t GetHitCount() const;
+
+    std::uint64_t GetMissCount() const;
+
+    // сколько байт сейчас занимают записи
+    std::size_t GetMemoryUsage() const;
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<Document> documents;
+        std::size_t size;
+    };
+
+    const SearchServer& search_server_;
+    const std::size_t memory_budget_;
+    mutable std::mutex mutex_;
+    // в начале списка - записи, к которым обращались последними
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> key_to_entry_;
+    std::size_t memory_usage_ = 0;
+    std::uint64_t epoch_ = 0;
+    std::uint64_t hit_count_ = 0;
+    std::uint64_t miss_count_ = 0;
+
+    // ключ запроса с добавкой фильтра и числа результатов
+    std::string MakeKey(std::string_view raw_query, std::string_view filter_key, int max_result_count) const;
+
+    // ищет ответ и считает попадание или промах
+    bool Find(const std::string& key, std::vector<Document>& documents);
+
+    // запоминает ответ, вытесняя давно не нужные записи, пока не уложится в бюджет
+    void Insert(std::string key, const std::vector<Document>& documents);
+
+    // под захваченным mutex_: сбрасывает всё, если сервер изменился
+    void CheckEpoch();
+
+    template <typename Search>
+    std::vector<Document> FindOrSearch(std::string key, Search search);
+};
+
+template <typename Filter>
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, std::string_view filter_name, Filter filtering_predicat,
+                                                         int max_result_count)
+{
+    // префикс отличает имя фильтра от статуса
+    std::string filter_key(1, 'f');
+    filter_key += filter_name;
+    return FindOrSearch(MakeKey(raw_query, filter_key, max_result_count), [&]
+                        { return search_server_.FindTopDocuments(raw_query, filtering_predicat, max_result_count); });
+}
+
+template <typename Search>
+std::vector<Document> QueryResultCache::FindOrSearch(std::string key, Search search)
+{
+    std::vector<Document> documents;
+    if (Find(key, documents))
+    {
+        return documents;
+    }
+    // считаем без блокировки: другие потоки тем временем обслуживаются из кэша
+    documents = search();
+    Insert(std::move(key), documents);
+    return documents;
+}
@@ -0,0 +1,81 @@
+#include "rating_index.h"
+
+#include <algorithm>
+
+void RatingIndex::Add(int rating, int internal_id)
+{
+    std::vector<int> &internal_ids = rating_to_internal_ids_[rating];
+    if (internal_ids.empty() || internal_ids.back() < internal_id)
+    {
+        internal_ids.push_back(internal_id);
+    }
+    else
+    {
+        const auto position = std::lower_bound(internal_ids.begin(), internal_ids.end(), internal_id);
+        if (position != internal_ids.end() && *position == internal_id)
+        {
+            return;
+        }
+        internal_ids.insert(position, internal_id);
+    }
+    ++document_count_;
+}
+
+void RatingIndex::Remove(int rating, int internal_id)
+{
+    Remove(rating, std::vector<int>{internal_id});
+}
+
+void RatingIndex::Remove(int rating, const std::vector<int> &removed_ids)
+{
+    const auto it = rating_to_internal_ids_.find(rating);
+    if (it == rating_to_internal_ids_.end())
+    {
+        return;
+    }
+    std::vector<int> &internal_ids = it->second;
+    // оба списка отсортированы, оставшиеся номера сдвигаются к началу за один проход
+    auto removed = removed_ids.begin();
+    const auto new_end = std::remove_if(internal_ids.begin(), internal_ids.end(), [&removed, &removed_ids](int internal_id)
+    {
+        removed = std::lower_bound(removed, removed_ids.end(), internal_id);
+        return removed != removed_ids.end() && *removed == internal_id;
+    });
+    document_count_ -= static_cast<int>(internal_ids.end() - new_end);
+    internal_ids.erase(new_end, internal_ids.end());
+    if (internal_ids.empty())
+    {
+        rating_to_internal_ids_.erase(it);
+    }
+}
+
+int RatingIndex::CountInRange(int min_rating, int max_rating) const
+{
+    int count = 0;
+    for (auto it = rating_to_internal_ids_.lower_bound(min_rating); it != rating_to_internal_ids_.end() && it->first <= max_rating; ++it)
+    {
+        count += static_cast<int>(it->second.size());
+    }
+    return count;
+}
+
+void RatingIndex::FindInRange(int min_rating, int max_rating, std::vector<int> &internal_ids) const
+{
+    internal_ids.clear();
+    int run_count = 0;
+    for (auto it = rating_to_internal_ids_.lower_bound(min_rating); it != rating_to_internal_ids_.end() && it->first <= max_rating; ++it)
+    {
+        internal_ids.insert(internal_ids.end(), it->second.begin(), it->second.end());
+        ++run_count;
+    }
+    // номера одного рейтинга уже по возрастанию, несколько кусков приходится сортировать
+    if (run_count > 1)
+    {
+        std::sort(internal_ids.begin(), internal_ids.end());
+    }
+}
+
+int RatingIndex::GetDocumentCount() const
+{
+    return document_count_;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+// вторичный индекс по среднему рейтингу: для каждого значения рейтинга - внутренние номера документов
+// с ним по возрастанию. Документы с рейтингом из отрезка находятся, не проходя столбец рейтингов
+// и списки документов слов, поэтому избирательный фильтр по рейтингу обходит только свои документы
+class RatingIndex
+{
+public:
+    // быстрее всего, когда номер больше всех уже добавленных с этим рейтингом - так выдаёт их сервер
+    void Add(int rating, int internal_id);
+
+    void Remove(int rating, int internal_id);
+
+    // удаляет сразу несколько документов с одним рейтингом; номера должны идти по возрастанию
+    void Remove(int rating, const std::vector<int>& internal_ids);
+
+    // число документов с рейтингом из [min_rating, max_rating]
+    int CountInRange(int min_rating, int max_rating) const;
+
+    // записывает в internal_ids номера документов с рейтингом из [min_rating, max_rating] по возрастанию
+    void FindInRange(int min_rating, int max_rating, std::vector<int>& internal_ids) const;
+
+    int GetDocumentCount() const;
+
+private:
+    std::map<int, std::vector<int>> rating_to_internal_ids_;
+    int document_count_ = 0;
+};
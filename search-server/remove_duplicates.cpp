@@ -2,19 +2,19 @@
 
 #include <map>
 #include <set>
-#include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 #include <iostream>
 
 void RemoveDuplicates(SearchServer& search_server)
 {
-    std::map<std::set<std::string>, int> words_to_id;
+    std::map<std::set<std::string_view>, int> words_to_id;
     std::vector<int> ids_of_duplicates;
 
     for (const int doc_id : search_server)
     {
-        std::set<std::string> doc_words;
+        std::set<std::string_view> doc_words;
         for (const auto& [word, freq] : search_server.GetWordFrequencies(doc_id))
         {
             doc_words.insert(word);
@@ -27,9 +27,6 @@ void RemoveDuplicates(SearchServer& search_server)
             words_to_id[doc_words] = doc_id;
         }
     }
-    while(!ids_of_duplicates.empty())
-    {
-        search_server.RemoveDocument(ids_of_duplicates.back());
-        ids_of_duplicates.pop_back();
-    }
+    // удаляем все дубликаты одним пакетом, так каждый список документов слова обновляется один раз
+    search_server.RemoveDocuments(ids_of_duplicates);
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "score_accumulator.h"
+
+void ScoreAccumulator::Reset(int document_capacity, int candidate_estimate)
+{
+    if (is_dense_)
+    {
+        for (const int document_id : touched_)
+        {
+            scores_[document_id] = 0;
+            states_[document_id] = State::UNTOUCHED;
+        }
+    }
+    touched_.clear();
+    sparse_scores_.clear();
+
+    is_dense_ = candidate_estimate * DENSE_CANDIDATE_RATIO >= document_capacity;
+    if (is_dense_ && static_cast<int>(scores_.size()) < document_capacity)
+    {
+        scores_.resize(document_capacity, 0);
+        states_.resize(document_capacity, State::UNTOUCHED);
+    }
+}
+
+void ScoreAccumulator::Add(int document_id, double score)
+{
+    if (!is_dense_)
+    {
+        sparse_scores_[document_id] += score;
+        return;
+    }
+    State &state = states_[document_id];
+    if (state == State::UNTOUCHED)
+    {
+        touched_.push_back(document_id);
+    }
+    state = State::PRESENT;
+    scores_[document_id] += score;
+}
+
+void ScoreAccumulator::Erase(int document_id)
+{
+    if (!is_dense_)
+    {
+        sparse_scores_.erase(document_id);
+        return;
+    }
+    if (states_[document_id] == State::PRESENT)
+    {
+        states_[document_id] = State::ERASED;
+        scores_[document_id] = 0;
+    }
+}
+
+bool ScoreAccumulator::IsDense() const
+{
+    return is_dense_;
+}
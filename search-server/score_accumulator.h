@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+// накопитель релевантности одного запроса, рассчитан на многократное использование.
+// Плотный режим - массив по внутреннему номеру документа и список затронутых номеров:
+// между запросами обнуляются только затронутые ячейки, в цикле по спискам документов нет выделений памяти.
+// Для избирательных запросов, где кандидатов мало по сравнению с числом документов, - хеш-таблица
+class ScoreAccumulator
+{
+public:
+    // готовит накопитель к новому запросу. document_capacity - граница внутренних номеров,
+    // candidate_estimate - оценка сверху числа кандидатов, по ней выбирается режим
+    void Reset(int document_capacity, int candidate_estimate);
+
+    void Add(int document_id, double score);
+
+    // убирает документ из кандидатов
+    void Erase(int document_id);
+
+    bool IsDense() const;
+
+    // проход по кандидатам по возрастанию номера, func(document_id, score)
+    template <typename Function>
+    void Collect(Function func);
+
+private:
+    // плотный режим выбираем, если кандидатов не меньше 1/DENSE_CANDIDATE_RATIO от числа документов
+    static constexpr long long DENSE_CANDIDATE_RATIO = 32;
+
+    enum class State : char
+    {
+        UNTOUCHED,
+        PRESENT,
+        ERASED,
+    };
+
+    bool is_dense_ = true;
+    std::vector<double> scores_;
+    std::vector<State> states_;
+    // номера, ячейки которых менялись с последнего Reset; в хеш-режиме сюда собираются ключи для Collect
+    std::vector<int> touched_;
+    std::unordered_map<int, double> sparse_scores_;
+};
+
+template <typename Function>
+void ScoreAccumulator::Collect(Function func)
+{
+    if (!is_dense_)
+    {
+        touched_.clear();
+        for (const auto &[document_id, score] : sparse_scores_)
+        {
+            touched_.push_back(document_id);
+        }
+        std::sort(touched_.begin(), touched_.end());
+        for (const int document_id : touched_)
+        {
+            func(document_id, sparse_scores_.at(document_id));
+        }
+        touched_.clear();
+        return;
+    }
+    // порядок выдачи не должен зависеть от режима и порядка слов запроса
+    std::sort(touched_.begin(), touched_.end());
+    for (const int document_id : touched_)
+    {
+        if (states_[document_id] == State::PRESENT)
+        {
+            func(document_id, scores_[document_id]);
+        }
+    }
+}
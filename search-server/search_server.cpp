@@ -4,84 +4,188 @@
 #include <algorithm>
 #include <stdexcept>
 #include <numeric>
+#include <iterator>
+#include <execution>
+#include <array>
+#include <cstdio>
+#include <limits>
 
 #include "string_processing.h"
 #include "document.h"
 
 using namespace std::literals::string_literals;
 
-SearchServer::SearchServer(const std::string &text) : SearchServer(SplitIntoWords(text)) {}
+SearchServer::SearchServer(const std::string &text) : SearchServer(std::string_view(text)) {}
 
-void SearchServer::AddDocument(int document_id, const std::string &document, DocumentStatus status, const std::vector<int> &ratings)
+SearchServer::SearchServer(std::string_view text) : SearchServer(SplitIntoWords(text)) {}
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
 {
-    if (document_id < 0 || document_data_.count(document_id) == 1)
+    CheckNewDocumentId(document_id);
+    // сначала проверяем все слова, чтобы не оставить в индексе половину документа
+    const std::map<std::string_view, int> word_counts = CountWords(document);
+    const int internal_id = AddDocumentData(document_id, status, ratings, GetWordCount(word_counts));
+    std::vector<std::pair<int, double>> term_frequencies;
+    for (const auto &[word, count] : word_counts)
     {
-        throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+        // строка выделяется только для нового слова
+        const int term_id = terms_.Intern(word);
+        term_frequencies.push_back({term_id, count * document_word_weights_[internal_id]});
+        // документ попадает в список каждого своего слова ровно одной записью
+        GetPostingList(status, term_id).Add(internal_id, count, term_frequencies.back().second);
+        UpdateLogDocumentFrequency(term_id);
     }
-    const std::vector<std::string> words = SplitIntoWordsNoStop(document);
-    for (const auto &word : words)
+    SetDocumentWords(internal_id, std::move(term_frequencies));
+    UpdateLogDocumentCount();
+}
+
+std::vector<AddDocumentError> SearchServer::AddDocuments(const std::vector<DocumentToAdd> &documents)
+{
+    std::vector<AddDocumentError> errors;
+
+    // id проверяем последовательно, повтор id внутри пакета - тоже ошибка
+    std::vector<bool> is_id_accepted(documents.size());
+    std::set<int> batch_ids;
+    for (std::size_t i = 0; i < documents.size(); ++i)
     {
-        if (!IsValidWord(word))
+        try
         {
-            throw std::invalid_argument("There must be no special symbols in a document content"s);
+            CheckNewDocumentId(documents[i].id);
+            if (!batch_ids.insert(documents[i].id).second)
+            {
+                throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+            }
+            is_id_accepted[i] = true;
         }
+        catch (const std::invalid_argument &e)
+        {
+            errors.push_back({documents[i].id, e.what()});
+        }
+    }
 
-        // записываем относительную частоту слова в документе (TF)
-        word_to_document_frequency_[word][document_id] += 1.0 / words.size();
-        // тоже записываем TF, но в еще одну удобную структуру для получения частоты слов в док-те по id
-        doc_id_to_word_frequency_[document_id][word] += 1.0 / words.size();
+    // частичный индекс куска пакета: слово -> (номер документа в пакете, TF)
+    struct PartialIndex
+    {
+        std::map<std::string_view, std::vector<std::pair<int, int>>> postings;
+        // номер в пакете и число слов документа
+        std::vector<std::pair<int, int>> parsed_documents;
+        std::vector<AddDocumentError> errors;
+    };
+    const int document_count = static_cast<int>(documents.size());
+    std::vector<int> chunk_starts;
+    for (int first = 0; first < document_count; first += ADD_BATCH_CHUNK_SIZE)
+    {
+        chunk_starts.push_back(first);
     }
-    document_data_[document_id] = {ComputeAverageRating(ratings), status};
-    added_documents_.insert(document_id);
+    std::vector<PartialIndex> partial_indexes(chunk_starts.size());
+    std::transform(std::execution::par, chunk_starts.begin(), chunk_starts.end(), partial_indexes.begin(), [&](int first)
+    {
+        PartialIndex partial_index;
+        for (int i = first; i < std::min(first + ADD_BATCH_CHUNK_SIZE, document_count); ++i)
+        {
+            if (!is_id_accepted[i])
+            {
+                continue;
+            }
+            try
+            {
+                const std::map<std::string_view, int> word_counts = CountWords(documents[i].text);
+                for (const auto &[word, count] : word_counts)
+                {
+                    partial_index.postings[word].push_back({i, count});
+                }
+                partial_index.parsed_documents.push_back({i, GetWordCount(word_counts)});
+            }
+            catch (const std::invalid_argument &e)
+            {
+                partial_index.errors.push_back({documents[i].id, e.what()});
+            }
+        }
+        return partial_index;
+    });
+
+    // сливаем частичные индексы в общий: каждое слово куска ищем в словаре один раз.
+    // Внутренние номера выдаются в порядке пакета, поэтому записи дописываются в конец списков
+    std::vector<int> internal_ids(documents.size());
+    std::vector<std::vector<std::pair<int, double>>> term_frequencies(documents.size());
+    for (const PartialIndex &partial_index : partial_indexes)
+    {
+        for (const auto &[i, word_count] : partial_index.parsed_documents)
+        {
+            const DocumentToAdd &document = documents[i];
+            internal_ids[i] = AddDocumentData(document.id, document.status, document.ratings, word_count);
+        }
+        for (const auto &[word, postings] : partial_index.postings)
+        {
+            const int term_id = terms_.Intern(word);
+            for (const auto &[i, count] : postings)
+            {
+                term_frequencies[i].push_back({term_id, count * document_word_weights_[internal_ids[i]]});
+                GetPostingList(documents[i].status, term_id).Add(internal_ids[i], count, term_frequencies[i].back().second);
+            }
+            UpdateLogDocumentFrequency(term_id);
+        }
+        for (const auto &[i, word_count] : partial_index.parsed_documents)
+        {
+            SetDocumentWords(internal_ids[i], std::move(term_frequencies[i]));
+        }
+        errors.insert(errors.end(), partial_index.errors.begin(), partial_index.errors.end());
+    }
+    UpdateLogDocumentCount();
+    return errors;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string &raw_query) const
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const
 {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string &raw_query, const DocumentStatus doc_status) const
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentStatus doc_status, int max_result_count) const
 {
-    return FindTopDocuments(raw_query, [doc_status](int document_id, DocumentStatus status, int rating)
-                            { return status == doc_status; });
+    return FindTopDocuments(std::execution::seq, raw_query, doc_status, max_result_count);
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string &raw_query, int document_id) const
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter &filter, int max_result_count) const
 {
-    const ProcessedQuery query = ParseQuery(raw_query); // query input errors are thrown there
-    std::vector<std::string> plus_words_in_document;
+    return FindTopDocuments(std::execution::seq, raw_query, filter, max_result_count);
+}
 
-    // сначала обработаем минус-слова, если найдем минус-слова, то вернем сразу пустой вектор и выйдем из функции
-    for (const std::string &minus_word : query.minus_words) 
+void SearchServer::CheckMaxResultCount(int max_result_count)
+{
+    if (max_result_count < 0)
     {
-        if (word_to_document_frequency_.count(minus_word) == 0)
-        {
-            continue;
-        }
-        if (word_to_document_frequency_.at(minus_word).count(document_id))
-        {
-            return std::tuple(plus_words_in_document, document_data_.at(document_id).status);
-        }
+        throw std::invalid_argument("Result document count must not be negative"s);
     }
+}
 
-    // если минус-слов не нашли, то переходим к плюс-словам
-    for (const std::string &plus_word : query.plus_words)
-    {
-        if (word_to_document_frequency_.count(plus_word) == 0)
-        {
-            continue;
-        }
-        if (word_to_document_frequency_.at(plus_word).count(document_id))
-        {
-            plus_words_in_document.push_back(plus_word);
-        }
-    }
-    return std::tuple(plus_words_in_document, document_data_.at(document_id).status);
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
 int SearchServer::GetDocumentCount() const
 {
-    return document_data_.size();
+    return document_to_internal_id_.size();
+}
+
+std::uint64_t SearchServer::GetEpoch() const
+{
+    return epoch_;
+}
+
+std::string SearchServer::GetQueryKey(std::string_view raw_query) const
+{
+    const ProcessedQuery query = ParseQuery(raw_query);
+    // число плюс-слов отделяет их от минус-слов
+    std::string key;
+    key.reserve(sizeof(int) * (1 + query.plus_words.size() + query.minus_words.size()));
+    const int plus_word_count = static_cast<int>(query.plus_words.size());
+    key.append(reinterpret_cast<const char *>(&plus_word_count), sizeof(int));
+    for (const std::vector<int> *words : {&query.plus_words, &query.minus_words})
+    {
+        key.append(reinterpret_cast<const char *>(words->data()), words->size() * sizeof(int));
+    }
+    return key;
 }
 
 std::set<int>::const_iterator SearchServer::begin() const
@@ -94,15 +198,15 @@ std::set<int>::const_iterator SearchServer::end() const
     return added_documents_.end();
 }
 
-bool SearchServer::IsStopWord(const std::string &word) const
+bool SearchServer::IsStopWord(std::string_view word) const
 {
     return stop_words_.count(word) > 0;
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string &text) const
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
 {
-    std::vector<std::string> words;
-    for (const std::string &word : SplitIntoWords(text))
+    std::vector<std::string_view> words;
+    for (const std::string_view word : SplitIntoWords(text))
     {
         if (!IsStopWord(word))
         {
@@ -112,13 +216,122 @@ std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string &t
     return words;
 }
 
+void SearchServer::CheckNewDocumentId(int document_id) const
+{
+    if (document_id < 0 || document_to_internal_id_.count(document_id) == 1)
+    {
+        throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+    }
+}
+
+int SearchServer::AddDocumentData(int document_id, DocumentStatus status, const std::vector<int> &ratings, int word_count)
+{
+    const int internal_id = static_cast<int>(document_ids_.size());
+    document_ids_.push_back(document_id);
+    document_ratings_.push_back(ComputeAverageRating(ratings));
+    rating_index_.Add(document_ratings_.back(), internal_id);
+    document_statuses_.push_back(status);
+    // делим один раз на документ, а не на каждое слово
+    document_word_weights_.push_back(word_count > 0 ? 1.0 / word_count : 0);
+    forward_offsets_.push_back(forward_term_ids_.size());
+    forward_sizes_.push_back(0);
+    document_to_internal_id_[document_id] = internal_id;
+    added_documents_.insert(document_id);
+    return internal_id;
+}
+
+void SearchServer::SetDocumentWords(int internal_id, std::vector<std::pair<int, double>> term_frequencies)
+{
+    std::sort(term_frequencies.begin(), term_frequencies.end());
+    forward_offsets_.MutableData()[internal_id] = forward_term_ids_.size();
+    forward_sizes_.MutableData()[internal_id] = static_cast<std::uint32_t>(term_frequencies.size());
+    for (const auto &[term_id, freq] : term_frequencies)
+    {
+        forward_term_ids_.push_back(term_id);
+        forward_frequencies_.push_back(freq);
+    }
+}
+
+bool SearchServer::DocumentContainsWord(int internal_id, int term_id) const
+{
+    const int *first = forward_term_ids_.data() + forward_offsets_[internal_id];
+    const int *last = first + forward_sizes_[internal_id];
+    return std::binary_search(first, last, term_id);
+}
+
+std::map<std::string_view, int> SearchServer::CountWords(std::string_view document) const
+{
+    const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
+    if (!std::all_of(words.begin(), words.end(), IsValidWord))
+    {
+        throw std::invalid_argument("There must be no special symbols in a document content"s);
+    }
+    std::map<std::string_view, int> word_counts;
+    for (const std::string_view word : words)
+    {
+        ++word_counts[word];
+    }
+    return word_counts;
+}
+
+int SearchServer::GetWordCount(const std::map<std::string_view, int> &word_counts)
+{
+    int word_count = 0;
+    for (const auto &[word, count] : word_counts)
+    {
+        word_count += count;
+    }
+    return word_count;
+}
+
+std::array<StatusPostings, SearchServer::STATUS_COUNT> SearchServer::MakeStatusPostings()
+{
+    std::array<StatusPostings, STATUS_COUNT> status_postings;
+    status_postings[static_cast<int>(DocumentStatus::ACTUAL)] = StatusPostings(true);
+    return status_postings;
+}
+
+PostingList &SearchServer::GetPostingList(DocumentStatus status, int term_id)
+{
+    return word_to_document_frequency_[static_cast<int>(status)].Get(term_id);
+}
+
+std::vector<const PostingList *> SearchServer::GetPostingLists(const std::vector<int> &term_ids, StatusMask status_mask) const
+{
+    std::vector<const PostingList *> posting_lists;
+    for (const int term_id : term_ids)
+    {
+        ForEachPostingList(term_id, status_mask, [&posting_lists](const PostingList &postings)
+                           { posting_lists.push_back(&postings); });
+    }
+    return posting_lists;
+}
+
+int SearchServer::GetDocumentFrequency(int term_id) const
+{
+    int document_frequency = 0;
+    ForEachPostingList(term_id, ALL_STATUSES, [&document_frequency](const PostingList &postings)
+                       { document_frequency += postings.GetDocumentCount(); });
+    return document_frequency;
+}
+
+void SearchServer::UpdateLogDocumentFrequency(int term_id)
+{
+    while (term_id >= static_cast<int>(log_document_frequencies_.size()))
+    {
+        log_document_frequencies_.push_back(NO_DOCUMENTS_LOG_FREQUENCY);
+    }
+    const int document_frequency = GetDocumentFrequency(term_id);
+    log_document_frequencies_.MutableData()[term_id] = document_frequency > 0 ? std::log(static_cast<double>(document_frequency)) : NO_DOCUMENTS_LOG_FREQUENCY;
+}
+
 // функция обработки слова (отбрасываем минус если он есть), и постановки флагов минус-слова и стоп-слова
-SearchServer::QueryWord SearchServer::ProcessQueryWord(std::string raw_word) const 
+SearchServer::QueryWord SearchServer::ProcessQueryWord(std::string_view raw_word) const 
 {
     bool is_minus_word = 0;
     if (raw_word.front() == '-')
     {
-        raw_word.erase(0, 1);
+        raw_word.remove_prefix(1);
         is_minus_word = 1;
         if (raw_word.empty())
         {
@@ -140,11 +353,10 @@ SearchServer::QueryWord SearchServer::ProcessQueryWord(std::string raw_word) con
 }
 
 // возвращаем множества плюс- и минус- слов
-SearchServer::ProcessedQuery SearchServer::ParseQuery(const std::string &text) const 
+SearchServer::ProcessedQuery SearchServer::ParseQuery(std::string_view text) const 
 {
-    std::set<std::string> plus_words;
-    std::set<std::string> minus_words;
-    for (const std::string &word : SplitIntoWords(text))
+    ProcessedQuery query;
+    for (const std::string_view word : SplitIntoWords(text))
     {
         const QueryWord word_struct = ProcessQueryWord(word);
 
@@ -152,64 +364,360 @@ SearchServer::ProcessedQuery SearchServer::ParseQuery(const std::string &text) c
         {
             continue;
         }
+        // слово, которого нет в индексе, не найдёт и не исключит ни одного документа
+        const int term_id = terms_.Find(word_struct.word);
+        if (term_id == TermDictionary::NOT_FOUND)
+        {
+            continue;
+        }
         if (word_struct.is_minus_word)
         {
-            minus_words.insert(word_struct.word);
+            query.minus_words.push_back(term_id);
         }
         else
         {
-            plus_words.insert(word_struct.word);
+            query.plus_words.push_back(term_id);
         }
     }
-    return {plus_words, minus_words};
+    for (std::vector<int> *words : {&query.plus_words, &query.minus_words})
+    {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+    return query;
+}
+
+double SearchServer::CalculateIDF(int term_id) const // считаем IDF слова
+{
+    const double log_document_frequency = log_document_frequencies_[term_id];
+    if (log_document_frequency == NO_DOCUMENTS_LOG_FREQUENCY)
+    {
+        return 0;
+    }
+    return log_document_count_ - log_document_frequency;
 }
 
-double SearchServer::CalculateIDF(const std::string &word) const // считаем IDF слова
+bool SearchServer::IsMoreRelevant(const Document &lhs, const Document &rhs)
 {
-    if (word_to_document_frequency_.count(word))
+    // ОСТОРОЖНО! если не дописать здесь std:: перед abs,
+    // вызовется сишная функция abs, работающая только с интами - произойдут неявные преобразования типов, 
+    // и все будет неправильно работать
+    if (std::abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_DIFFERENCE)
     {
-        int times_word_in_documents = word_to_document_frequency_.at(word).size();
-        return std::log(static_cast<double>(document_data_.size()) / times_word_in_documents);
+        return lhs.rating > rhs.rating;
     }
     else
     {
-        return 0;
+        return lhs.relevance > rhs.relevance;
     }
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int> &ratings)
 {
+    if (ratings.empty())
+    {
+        return 0;
+    }
     int rating_sum = std::accumulate(ratings.begin(), ratings.end(), 0);
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-bool SearchServer::IsValidWord(const std::string &text)
+bool SearchServer::IsValidWord(std::string_view text)
 {
     return std::none_of(text.begin(), text.end(), [](char c)
                         { return c >= '\0' && c < ' '; });
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
 {
-    if (doc_id_to_word_frequency_.count(document_id))
+    std::map<std::string_view, double> word_frequencies;
+    if (const auto it = document_to_internal_id_.find(document_id); it != document_to_internal_id_.end())
     {
-        return doc_id_to_word_frequency_.at(document_id);
+        ForEachDocumentWord(it->second, [this, &word_frequencies](int term_id, double freq)
+                            { word_frequencies.emplace(terms_.GetTerm(term_id), freq); });
     }
-    static std::map<std::string, double> empty_map_;
-    return empty_map_;
+    return word_frequencies;
 }
 
 void SearchServer::RemoveDocument(int document_id)
 {
-    for (const auto& [word, freq] : doc_id_to_word_frequency_.at(document_id))
+    // слово остаётся в словаре, опустевший список документов ничего не стоит при поиске
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids)
+{
+    std::vector<int> sorted_ids = document_ids;
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+    if (!std::all_of(sorted_ids.begin(), sorted_ids.end(), [this](int document_id)
+                     { return document_to_internal_id_.count(document_id) > 0; }))
+    {
+        throw std::out_of_range("Could not remove document with unknown id"s);
+    }
+    std::vector<int> internal_ids(sorted_ids.size());
+    std::transform(sorted_ids.begin(), sorted_ids.end(), internal_ids.begin(), [this](int document_id)
+                   { return document_to_internal_id_.at(document_id); });
+    std::sort(internal_ids.begin(), internal_ids.end());
+
+    // группируем по спискам: (id слова, статус) -> внутренние номера удаляемых документов по возрастанию
+    std::map<std::pair<int, int>, std::vector<int>> list_to_removed_ids;
+    for (const int internal_id : internal_ids)
+    {
+        const int status = static_cast<int>(document_statuses_[internal_id]);
+        ForEachDocumentWord(internal_id, [internal_id, status, &list_to_removed_ids](int term_id, double)
+                            { list_to_removed_ids[{term_id, status}].push_back(internal_id); });
+    }
+    std::vector<std::pair<std::pair<int, int>, std::vector<int>>> removals(std::make_move_iterator(list_to_removed_ids.begin()),
+                                                                           std::make_move_iterator(list_to_removed_ids.end()));
+    std::for_each(std::execution::par, removals.begin(), removals.end(), [this](const auto &removal)
+                  {
+                      const auto [term_id, status] = removal.first;
+                      word_to_document_frequency_[status].Find(term_id)->Remove(removal.second);
+                  });
+    for (const auto &removal : removals)
+    {
+        UpdateLogDocumentFrequency(removal.first.first);
+    }
+    // номера идут по возрастанию, поэтому и у каждого рейтинга получаются по возрастанию
+    std::map<int, std::vector<int>> rating_to_removed_ids;
+    for (const int internal_id : internal_ids)
+    {
+        rating_to_removed_ids[document_ratings_[internal_id]].push_back(internal_id);
+    }
+    for (const auto &[rating, removed_ids] : rating_to_removed_ids)
+    {
+        rating_index_.Remove(rating, removed_ids);
+    }
+
+    for (const int internal_id : internal_ids)
     {
-        word_to_document_frequency_.at(word).erase(document_id);
-        if (word_to_document_frequency_.at(word).empty())
+        EraseDocumentData(document_ids_[internal_id], internal_id);
+    }
+}
+
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status)
+{
+    const int internal_id = document_to_internal_id_.at(document_id);
+    const DocumentStatus old_status = document_statuses_[internal_id];
+    if (old_status == status)
+    {
+        return;
+    }
+    // df слов не меняется, поэтому log df не пересчитывается
+    const double weight = document_word_weights_[internal_id];
+    ForEachDocumentWord(internal_id, [&](int term_id, double term_frequency)
+    {
+        word_to_document_frequency_[static_cast<int>(old_status)].Find(term_id)->Remove(internal_id);
+        GetPostingList(status, term_id).Add(internal_id, static_cast<int>(std::lround(term_frequency / weight)), term_frequency);
+    });
+    document_statuses_.MutableData()[internal_id] = status;
+    ++epoch_;
+}
+
+void SearchServer::EraseDocumentData(int document_id, int internal_id)
+{
+    // столбцы не сжимаем: внутренний номер удалённого документа больше не встретится в списках документов слов
+    document_to_internal_id_.erase(document_id);
+    added_documents_.erase(document_id);
+    forward_sizes_.MutableData()[internal_id] = 0;
+    UpdateLogDocumentCount();
+}
+
+void SearchServer::CopyDocument(const SearchServer &source, int source_internal_id, std::vector<int> &term_ids)
+{
+    const int document_id = source.document_ids_[source_internal_id];
+    CheckNewDocumentId(document_id);
+    const double weight = source.document_word_weights_[source_internal_id];
+    // средний рейтинг одного числа - оно само; вес - 1 / число слов, так что TF совпадут до бита
+    const int internal_id = AddDocumentData(document_id, source.document_statuses_[source_internal_id],
+                                            {source.document_ratings_[source_internal_id]}, weight > 0 ? static_cast<int>(std::lround(1.0 / weight)) : 0);
+    std::vector<std::pair<int, double>> term_frequencies;
+    source.ForEachDocumentWord(source_internal_id, [&](int source_term_id, double term_frequency)
+    {
+        int &term_id = term_ids[source_term_id];
+        if (term_id < 0)
         {
-            word_to_document_frequency_.erase(word);    
+            term_id = terms_.Intern(source.terms_.GetTerm(source_term_id));
         }
-    }    
-    document_data_.erase(document_id);
-    added_documents_.erase(document_id);
-    doc_id_to_word_frequency_.erase(document_id);
-}
\ No newline at end of file
+        term_frequencies.push_back({term_id, term_frequency});
+        GetPostingList(source.document_statuses_[source_internal_id], term_id).Add(internal_id, static_cast<int>(std::lround(term_frequency / weight)),
+                                                                                   term_frequency);
+        UpdateLogDocumentFrequency(term_id);
+    });
+    SetDocumentWords(internal_id, std::move(term_frequencies));
+}
+
+void SearchServer::CheckOpenedIndex(const MappedVector<int> &live_internal_ids, const std::string &path) const
+{
+    // номера и смещения из файла дальше служат индексами массивов без проверок
+    const auto check = [&path](bool condition)
+    {
+        if (!condition)
+        {
+            throw std::runtime_error("Index file "s + path + " has inconsistent document data"s);
+        }
+    };
+    const std::size_t document_count = document_ids_.size();
+    check(document_count <= static_cast<std::size_t>(std::numeric_limits<int>::max()));
+    check(document_ratings_.size() == document_count && document_statuses_.size() == document_count
+          && document_word_weights_.size() == document_count && forward_offsets_.size() == document_count
+          && forward_sizes_.size() == document_count);
+    check(forward_frequencies_.size() == forward_term_ids_.size());
+    check(log_document_frequencies_.size() <= static_cast<std::size_t>(terms_.Size()));
+    for (const double log_document_frequency : log_document_frequencies_)
+    {
+        // сравнение ложно и для NaN
+        check(log_document_frequency == NO_DOCUMENTS_LOG_FREQUENCY || log_document_frequency >= 0);
+    }
+
+    for (std::size_t internal_id = 0; internal_id < document_count; ++internal_id)
+    {
+        check(static_cast<int>(document_statuses_[internal_id]) >= 0 && static_cast<int>(document_statuses_[internal_id]) < STATUS_COUNT);
+        check(forward_offsets_[internal_id] <= forward_term_ids_.size()
+              && forward_sizes_[internal_id] <= forward_term_ids_.size() - forward_offsets_[internal_id]);
+    }
+    for (const int term_id : forward_term_ids_)
+    {
+        check(term_id >= 0 && static_cast<std::size_t>(term_id) < log_document_frequencies_.size());
+    }
+    for (const int internal_id : live_internal_ids)
+    {
+        check(internal_id >= 0 && static_cast<std::size_t>(internal_id) < document_count);
+    }
+    for (const StatusPostings &status_postings : word_to_document_frequency_)
+    {
+        status_postings.ForEach([&](int term_id, const PostingList &postings)
+                                {
+                                    check(static_cast<std::size_t>(term_id) < log_document_frequencies_.size());
+                                    // PostingList::Open уже проверил, что id списка строго растут до GetLastDocumentId
+                                    check(static_cast<std::size_t>(postings.GetLastDocumentId() + 1) <= document_count);
+                                });
+    }
+}
+
+void SearchServer::UpdateLogDocumentCount()
+{
+    const int document_count = GetDocumentCount();
+    log_document_count_ = document_count == 0 ? 0 : std::log(static_cast<double>(document_count));
+    ++epoch_;
+}
+void SearchServer::SaveIndex(const std::string &path) const
+{
+    // файл по path может быть отображён в память сервером, открытым через OpenIndex: обрезать его нельзя,
+    // поэтому пишем рядом и подменяем имя - старое отображение продолжает смотреть в прежний файл.
+    // Данные сбрасываются на диск до переименования, иначе после падения под именем мог бы оказаться пустой файл
+    const std::string temporary_path = path + ".tmp"s;
+    try
+    {
+        WriteIndex(temporary_path);
+        SyncPath(temporary_path);
+    }
+    catch (const std::runtime_error &)
+    {
+        std::remove(temporary_path.c_str());
+        throw;
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Could not rename index file to "s + path);
+    }
+}
+
+void SearchServer::WriteIndex(const std::string &path) const
+{
+    IndexWriter writer(path);
+    writer.Write(INDEX_MAGIC);
+    writer.Write(INDEX_VERSION);
+    writer.Write(INDEX_BYTE_ORDER_MARK);
+
+    writer.WriteStrings(std::vector<std::string_view>(stop_words_.begin(), stop_words_.end()));
+    std::vector<std::string_view> terms;
+    for (int term_id = 0; term_id < terms_.Size(); ++term_id)
+    {
+        terms.push_back(terms_.GetTerm(term_id));
+    }
+    writer.WriteStrings(terms);
+    writer.WriteArray(terms_.GetSortedTermIds());
+
+    for (const StatusPostings &status_postings : word_to_document_frequency_)
+    {
+        status_postings.Save(writer);
+    }
+    writer.WriteArray(log_document_frequencies_);
+
+    writer.WriteArray(document_ids_);
+    writer.WriteArray(document_ratings_);
+    writer.WriteArray(document_statuses_);
+    writer.WriteArray(document_word_weights_);
+    writer.WriteArray(forward_offsets_);
+    writer.WriteArray(forward_sizes_);
+    writer.WriteArray(forward_term_ids_);
+    writer.WriteArray(forward_frequencies_);
+
+    // живые документы по возрастанию внешнего id
+    std::vector<int> live_internal_ids;
+    for (const auto &[document_id, internal_id] : document_to_internal_id_)
+    {
+        live_internal_ids.push_back(internal_id);
+    }
+    writer.WriteArray(live_internal_ids);
+    writer.Finish();
+}
+
+SearchServer SearchServer::OpenIndex(const std::string &path)
+{
+    auto file = std::make_shared<const MappedFile>(path);
+    IndexReader reader(*file);
+    const auto magic = reader.Read<std::array<char, sizeof(INDEX_MAGIC)>>();
+    if (!std::equal(magic.begin(), magic.end(), INDEX_MAGIC) || reader.Read<std::uint32_t>() != INDEX_VERSION
+        || reader.Read<std::uint32_t>() != INDEX_BYTE_ORDER_MARK)
+    {
+        throw std::runtime_error("Index file "s + path + " has unsupported format or version"s);
+    }
+
+    SearchServer server(reader.ReadStrings());
+    server.mapped_index_ = file;
+    const std::vector<std::string_view> terms = reader.ReadStrings();
+    const MappedVector<int> sorted_term_ids = reader.ReadArray<int>();
+    server.terms_ = TermDictionary(terms, std::vector<int>(sorted_term_ids.begin(), sorted_term_ids.end()));
+
+    for (StatusPostings &status_postings : server.word_to_document_frequency_)
+    {
+        status_postings = StatusPostings::Open(reader, status_postings.IsDense(), static_cast<int>(terms.size()));
+    }
+    server.log_document_frequencies_ = reader.ReadArray<double>();
+
+    server.document_ids_ = reader.ReadArray<int>();
+    server.document_ratings_ = reader.ReadArray<int>();
+    server.document_statuses_ = reader.ReadArray<DocumentStatus>();
+    server.document_word_weights_ = reader.ReadArray<double>();
+    server.forward_offsets_ = reader.ReadArray<std::uint64_t>();
+    server.forward_sizes_ = reader.ReadArray<std::uint32_t>();
+    server.forward_term_ids_ = reader.ReadArray<int>();
+    server.forward_frequencies_ = reader.ReadArray<double>();
+    const MappedVector<int> live_internal_ids = reader.ReadArray<int>();
+    server.CheckOpenedIndex(live_internal_ids, path);
+
+    // внешние id записаны по возрастанию, поэтому словарь и множество строятся вставками в конец
+    for (const int internal_id : live_internal_ids)
+    {
+        const int document_id = server.document_ids_[internal_id];
+        server.document_to_internal_id_.emplace_hint(server.document_to_internal_id_.end(), document_id, internal_id);
+        server.added_documents_.emplace_hint(server.added_documents_.end(), document_id);
+    }
+    if (server.document_to_internal_id_.size() != live_internal_ids.size())
+    {
+        throw std::runtime_error("Index file "s + path + " has duplicate documents"s);
+    }
+    // индекс рейтингов дописывается по возрастанию внутренних номеров
+    std::vector<int> sorted_internal_ids(live_internal_ids.begin(), live_internal_ids.end());
+    std::sort(sorted_internal_ids.begin(), sorted_internal_ids.end());
+    for (const int internal_id : sorted_internal_ids)
+    {
+        server.rating_index_.Add(server.document_ratings_[internal_id], internal_id);
+    }
+    server.UpdateLogDocumentCount();
+    return server;
+}
@@ -1,16 +1,34 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
 #include <set>
 #include <algorithm>
+#include <limits>
 #include <stdexcept>
+#include <execution>
+#include <type_traits>
 
 #include "string_processing.h"
 #include "document.h"
+#include "document_filter.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "status_postings.h"
+#include "concurrent_map.h"
+#include "score_accumulator.h"
+#include "excluded_documents.h"
+#include "rating_index.h"
+#include "mapped_vector.h"
+#include "index_file.h"
 #include "tests.h"
 
+// сколько документов возвращает FindTopDocuments, если не попросили другое количество
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 constexpr double MAX_RELEVANCE_DIFFERENCE = 1e-6;
 
@@ -21,90 +39,330 @@ class SearchServer
 public:
     explicit SearchServer(const std::string& text);
 
+    explicit SearchServer(std::string_view text);
+
     template <typename StringCollection>
     SearchServer(const StringCollection &stop_words_init);
 
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // добавляет пакет документов: разбор на слова идёт параллельно, в индекс всё сливается за один проход.
+    // Документы с ошибками пропускаются, остальные добавляются; возвращает ошибки
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentToAdd>& documents);
 
     // перегруженная функция для обработки аргументов только из строки
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const; 
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const; 
 
     // перегруженная функция для обработки аргументов только из строки+статуса
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, const DocumentStatus doc_status) const; 
+    // max_result_count - сколько лучших документов вернуть
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentStatus doc_status,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const; 
 
     // вторым аргументом принимаем лямбду-фильтр документов
     template <typename Filter>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, Filter filtering_predicat) const; 
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter filtering_predicat,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const; 
+
+    // декларативный фильтр: его статусы выбирают списки документов слов, а отрезки рейтингов и id
+    // для широких запросов проверяются заранее по столбцам всех документов
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // те же три варианта с политикой выполнения: std::execution::seq или std::execution::par.
+    // При par фильтр вызывается из нескольких потоков одновременно
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentStatus doc_status,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename ExecutionPolicy, typename Filter>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, Filter filtering_predicat,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentFilter& filter,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    // возвращает слова запроса, найденные в документе, по алфавиту; строки принадлежат серверу
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // при std::execution::par плюс-слова проверяются в нескольких потоках
+    template <typename ExecutionPolicy>
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const;
 
     int GetDocumentCount() const;
 
+    // номер версии индекса, растёт при каждом добавлении и удалении документов; по нему кэши понимают,
+    // что сохранённые ответы устарели
+    std::uint64_t GetEpoch() const;
+
+    // нормализованный запрос: id плюс- и минус-слов по возрастанию, без стоп-слов, повторов и слов,
+    // которых нет в индексе. Запросы с одинаковым ключом в одной эпохе дают одинаковый ответ.
+    // Бросает invalid_argument на некорректный запрос, как FindTopDocuments
+    std::string GetQueryKey(std::string_view raw_query) const;
+
     std::set<int>::const_iterator begin() const;
 
     std::set<int>::const_iterator end() const;
 
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(int document_id);
+
+    // при std::execution::par списки документов разных слов обновляются в нескольких потоках
+    template <typename ExecutionPolicy>
+    void RemoveDocument(ExecutionPolicy&& policy, int document_id);
+
+    // удаляет пакет документов: список документов каждого слова обновляется один раз на весь пакет.
+    // Если хоть одного id нет, бросает std::out_of_range и ничего не удаляет
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // переносит документ в списки документов слов другого статуса. Документ обычно не последний
+    // в списках нового статуса, поэтому они пересобираются - это дороже добавления.
+    // Бросает std::out_of_range, если документа нет
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    // записывает индекс во временный файл рядом, сбрасывает его на диск и переименовывает в path, так что
+    // сохранять можно и в файл, из которого сервер открыт OpenIndex. Бросает std::runtime_error, если записать не удалось
+    void SaveIndex(const std::string& path) const;
+
+    // пишет индекс прямо в path, без временного файла и fsync - для тех, кто сам подменяет файл целиком.
+    // Файл, из которого сервер открыт OpenIndex, так перезаписывать нельзя
+    void WriteIndex(const std::string& path) const;
+
+    // открывает файл, записанный SaveIndex, отображая его в память: списки документов, прямой индекс
+    // и столбцы документов читаются прямо из файла, а копируются к себе только при изменении.
+    // Бросает std::runtime_error, если файла нет, формат не тот или номера и смещения выходят за массивы
+    static SearchServer OpenIndex(const std::string& path);
 private:
 
     // позволяет тестам смотреть в приватные поля класса
     friend class Tests;
+    // сегменты ищутся с общим IDF и пометками удаления, сливаются без повторного разбора текста
+    friend class SegmentedSearchServer;
+    // журналируемый сервер проверяет слова документа до записи в журнал, а применяет изменение после
+    friend class DurableSearchServer;
 
-    struct DocumentData
-    {
-        int rating;
-        DocumentStatus status;
-    };
+    // каждое слово хранится один раз в словаре, индексы ниже работают с его id
+    TermDictionary terms_;
+
+    static constexpr int STATUS_COUNT = DOCUMENT_STATUS_COUNT;
 
-    // храним в map для каждого встреченного слова id документов и частоту слова
-    std::map<std::string, std::map<int, double>> word_to_document_frequency_; 
+    // списки документов слов по статусам: [статус][id слова] - отсортированный список внутренних номеров
+    // документов этого статуса и чисел вхождений слова. Запрос по статусу проходит только свои списки.
+    // Почти все документы обычно ACTUAL, поэтому его списки хранятся плотно, а списки прочих статусов -
+    // разреженно, только для слов, встречавшихся в документах этого статуса
+    std::array<StatusPostings, STATUS_COUNT> word_to_document_frequency_ = MakeStatusPostings();
+
+    // по id слова: логарифм числа документов со словом по всем статусам, обновляется вместе со списками,
+    // чтобы IDF при поиске был одним чтением массива, без std::log и обхода списков
+    MappedVector<double> log_document_frequencies_;
+    // в log_document_frequencies_ у слова, которого нет ни в одном документе: логарифм df не бывает отрицательным,
+    // а 0 занят словами из одного документа
+    static constexpr double NO_DOCUMENTS_LOG_FREQUENCY = -1;
 
     // в множестве храним стоп-слова
-    const std::set<std::string> stop_words_;
+    const std::set<std::string, std::less<>> stop_words_;
+
+    // внешний id документа -> внутренний номер. Внутренние номера плотные, выдаются по возрастанию
+    // и не переиспользуются, поэтому внешние id могут быть сколь угодно разреженными,
+    // а новые документы всегда дописываются в конец списков документов слов
+    std::map<int, int> document_to_internal_id_;
+
+    // данные документов столбцами по внутреннему номеру: фильтр и выдача читают их за O(1)
+    MappedVector<int> document_ids_;
+    MappedVector<int> document_ratings_;
+    MappedVector<DocumentStatus> document_statuses_;
+    // вес одного вхождения слова, 1 / число слов документа: TF = число вхождений * вес
+    MappedVector<double> document_word_weights_;
 
-    // по id документа храним структуру с его рейтингом и статусом
-    std::map<int, DocumentData> document_data_;
+    // живые документы по среднему рейтингу, обновляется вместе со списками документов слов.
+    // В файл индекса не пишется, OpenIndex строит его по столбцу рейтингов
+    RatingIndex rating_index_;
 
     // храним id всех добавленных документов
     std::set<int> added_documents_;
 
-    //для метода GetWordFrequencies, хотим чтобы он работал за O(log N), что достигается в мэпе
-    std::map<int, std::map<std::string, double>> doc_id_to_word_frequency_;
+    // логарифм числа документов: IDF = log(N / df) = log N - log df, где log df хранит список документов слова.
+    // Изменение N обновляет одно число, а не IDF каждого слова
+    double log_document_count_ = 0;
+
+    // см. GetEpoch
+    std::uint64_t epoch_ = 0;
+
+    // прямой индекс: слова документа с внутренним номером i - отрезок длины forward_sizes_[i],
+    // начиная с forward_offsets_[i], в массивах id слов (по возрастанию) и их TF.
+    // Отрезки дописываются в конец массивов, у удалённого документа длина нулевая
+    MappedVector<std::uint64_t> forward_offsets_;
+    MappedVector<std::uint32_t> forward_sizes_;
+    MappedVector<int> forward_term_ids_;
+    MappedVector<double> forward_frequencies_;
+
+    // файл, открытый OpenIndex; массивы выше могут смотреть в него, копии сервера делят его между собой
+    std::shared_ptr<const MappedFile> mapped_index_;
+
+    // первые байты файла индекса и версия формата, меняется при любом изменении раскладки
+    static constexpr char INDEX_MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+    static constexpr std::uint32_t INDEX_VERSION = 6;
+    // по нему отличаем файл, записанный на машине с другим порядком байт
+    static constexpr std::uint32_t INDEX_BYTE_ORDER_MARK = 0x01020304;
     
+    // статусы, по спискам которых идёт поиск: бит i - статус со значением i
+    using StatusMask = std::uint32_t;
+    static constexpr StatusMask ALL_STATUSES = (StatusMask{1} << STATUS_COUNT) - 1;
+
+    static constexpr StatusMask GetStatusMask(DocumentStatus status)
+    {
+        return StatusMask{1} << static_cast<int>(status);
+    }
+
+    // слова запроса уже переведены в id, отсортированы и без повторов; слова, которых нет в индексе, отброшены
     struct ProcessedQuery
     {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        std::vector<int> plus_words;
+        std::vector<int> minus_words;
     };
 
+    // word смотрит в строку запроса
     struct QueryWord
     {
-        std::string word;
+        std::string_view word;
         bool is_minus_word;
         bool is_stop_word;
     };
 
-    bool IsStopWord(const std::string& word) const;
+    bool IsStopWord(std::string_view word) const;
+
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+
+    // бросает invalid_argument, если id отрицательный или уже занят
+    void CheckNewDocumentId(int document_id) const;
+
+    // заводит столбцы для нового документа и возвращает его внутренний номер
+    int AddDocumentData(int document_id, DocumentStatus status, const std::vector<int>& ratings, int word_count);
+
+    // записывает слова документа в прямой индекс; пары (id слова, TF)
+    void SetDocumentWords(int internal_id, std::vector<std::pair<int, double>> term_frequencies);
+
+    // func(term_id, term_frequency) для слов документа по возрастанию id слова
+    template <typename Function>
+    void ForEachDocumentWord(int internal_id, Function func) const;
+
+    bool DocumentContainsWord(int internal_id, int term_id) const;
+
+    // число вхождений каждого слова документа без стоп-слов; бросает invalid_argument, если в слове есть спецсимволы
+    std::map<std::string_view, int> CountWords(std::string_view document) const;
+
+    // число слов документа - сумма чисел вхождений
+    static int GetWordCount(const std::map<std::string_view, int>& word_counts);
+
+    static std::array<StatusPostings, STATUS_COUNT> MakeStatusPostings();
+
+    // возвращает список документов слова со статусом status, заводя его, если его нет
+    PostingList& GetPostingList(DocumentStatus status, int term_id);
+
+    // func(const PostingList&) для непустых списков документов слова со статусами из status_mask
+    template <typename Function>
+    void ForEachPostingList(int term_id, StatusMask status_mask, Function func) const;
+
+    // непустые списки документов слов запроса со статусами из status_mask
+    std::vector<const PostingList*> GetPostingLists(const std::vector<int>& term_ids, StatusMask status_mask) const;
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // число документов со словом по всем статусам
+    int GetDocumentFrequency(int term_id) const;
+
+    // вызывается после каждого изменения числа документов слова
+    void UpdateLogDocumentFrequency(int term_id);
 
     // функция обработки слова (отбрасываем минус если он есть), и постановки флагов минус-слова и стоп-слова
-    QueryWord ProcessQueryWord(std::string raw_word) const; 
+    QueryWord ProcessQueryWord(std::string_view raw_word) const; 
 
     //возвращаем множества плюс- и минус- слов
-    ProcessedQuery ParseQuery(const std::string& text) const; 
+    ProcessedQuery ParseQuery(std::string_view text) const; 
+
+    // бросает invalid_argument, если запрошено отрицательное число документов
+    static void CheckMaxResultCount(int max_result_count);
 
-    // ищем все документы, которые содержат слова из запроса
-    template <typename FilterFunction>
-    std::vector<Document> FindAllDocuments(ProcessedQuery processed_query, FilterFunction filtering_predicat) const; 
+    // фильтр-лямбда от (id, статус, рейтинг) как условие на внутренний номер документа;
+    // поиск ниже проверяет документы только такими условиями
+    template <typename Filter>
+    auto MakeDocumentPredicate(Filter filtering_predicat) const;
+
+    // FindTopDocuments по спискам статусов из status_mask; document_predicate(internal_id) проверяет
+    // только документы этих статусов
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsInStatuses(ExecutionPolicy&& policy, const ProcessedQuery& processed_query, StatusMask status_mask,
+                                                     DocumentPredicate document_predicate, int max_result_count) const;
+
+    // ищем все документы со статусами из status_mask, которые содержат слова из запроса
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const ProcessedQuery& processed_query, StatusMask status_mask, DocumentPredicate document_predicate) const; 
+
+    // то же с IDF слова idf(term_id) вместо своего и без документов, для которых is_deleted(internal_id)
+    template <typename DocumentPredicate, typename IdfFunction, typename DeletedFunction>
+    std::vector<Document> FindAllDocuments(const ProcessedQuery& processed_query, StatusMask status_mask, DocumentPredicate document_predicate,
+                                           IdfFunction idf, DeletedFunction is_deleted) const;
+
+    // лучшие max_result_count документов по убыванию релевантности (MaxScore). Документы обходятся по возрастанию id
+    // сразу по всем спискам; слова с малым наибольшим вкладом перестают порождать кандидатов, как только
+    // их сумма не дотягивает до худшего из уже найденных лучших, и лишь досчитывают чужих кандидатов пропусками.
+    // Оценки блоков списков позволяют пропускать целые блоки, где даже лучшие документы безнадёжны.
+    // Ответ совпадает с полным перебором: вклады слов складываются в том же порядке.
+    // Списки статусов из status_mask проходятся по очереди с общими лучшими документами
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPruned(const ProcessedQuery& processed_query, StatusMask status_mask,
+                                                 DocumentPredicate document_predicate, int max_result_count) const;
+
+    // лучшие max_result_count документов среди internal_ids (по возрастанию): курсоры списков плюс-слов
+    // перескакивают к каждому из них, а не проходят списки целиком. Документы других статусов пропускаются
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAmong(const ProcessedQuery& processed_query, StatusMask status_mask, const std::vector<int>& internal_ids,
+                                                DocumentPredicate document_predicate, int max_result_count) const;
+
+    // параллельная версия: списки документов плюс-слов режутся на куски, которые считаются в разных потоках
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const ProcessedQuery& processed_query, StatusMask status_mask,
+                                           DocumentPredicate document_predicate) const; 
+
+    // столько документов пакета AddDocuments разбирает одна параллельная задача
+    static constexpr int ADD_BATCH_CHUNK_SIZE = 256;
+
+    // столько записей списка документов обрабатывает одна параллельная задача
+    static constexpr int PARALLEL_CHUNK_SIZE = 4096;
+    // число корзин ConcurrentMap, в которую потоки складывают релевантность; см. BenchmarkConcurrentMap
+    static constexpr int SCORE_BUCKET_COUNT = 64;
+    // отрезки DocumentFilter проверяются по столбцам заранее, если записей в списках плюс-слов не меньше
+    // 1/SELECTION_SCAN_RATIO от числа документов; см. BenchmarkDocumentFilter
+    static constexpr long long SELECTION_SCAN_RATIO = 8;
+    // документы отрезка рейтингов DocumentFilter берутся из индекса рейтингов, если их меньше
+    // 1/RATING_INDEX_RATIO от записей в списках плюс-слов; см. BenchmarkRatingIndex
+    static constexpr long long RATING_INDEX_RATIO = 8;
     
-    double CalculateIDF(const std::string& word) const; // считаем IDF слова 
+    double CalculateIDF(int term_id) const; // считаем IDF слова 
+
+    // порядок выдачи: по убыванию релевантности, при почти равной релевантности - по убыванию рейтинга
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    // удаляет всё о документе, кроме записей в списках документов слов
+    void EraseDocumentData(int document_id, int internal_id);
+
+    // дописывает документ другого сервера с теми же id, статусом, рейтингом и TF; слова переводятся в свой словарь.
+    // term_ids - перевод id слов source в свои, -1 - ещё не переведено; заводится размером со словарь source
+    // и переиспользуется для всех документов source. log N не обновляет: после копий нужен UpdateLogDocumentCount
+    void CopyDocument(const SearchServer& source, int source_internal_id, std::vector<int>& term_ids);
+
+    // вызывается после каждого изменения числа документов; заодно сдвигает эпоху
+    void UpdateLogDocumentCount();
+
+    // проверяет, что прочитанные OpenIndex номера документов, номера слов и смещения прямого индекса
+    // не выходят за свои массивы; бросает std::runtime_error
+    void CheckOpenedIndex(const MappedVector<int>& live_internal_ids, const std::string& path) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
     
-    static bool IsValidWord(const std::string& text);
+    static bool IsValidWord(std::string_view text);
 };
 
 template <typename StringCollection>
@@ -117,71 +375,549 @@ SearchServer::SearchServer(const StringCollection &stop_words_init) : stop_words
 }
 
 template <typename Filter>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string &raw_query, Filter filtering_predicat) const
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, Filter filtering_predicat, int max_result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, filtering_predicat, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, std::string_view raw_query) const
+{
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, std::string_view raw_query, const DocumentStatus doc_status,
+                                                     int max_result_count) const
 {
+    CheckMaxResultCount(max_result_count);
     const ProcessedQuery query = ParseQuery(raw_query); // query input errors are thrown here
-    auto matched_documents = FindAllDocuments(query, filtering_predicat);
-    std::sort(matched_documents.begin(), matched_documents.end(),
-              [](const Document &lhs, const Document &rhs)
-              {
-                  // ОСТОРОЖНО! если не дописать здесь std:: перед abs,
-                  // вызовется сишная функция abs, работающая только с интами - произойдут неявные преобразования типов, 
-                  // и все будет неправильно работать
-                  if (std::abs(lhs.relevance - rhs.relevance) < MAX_RELEVANCE_DIFFERENCE)
-                  {
-                      return lhs.rating > rhs.rating;
-                  }
-                  else
-                  {
-                      return lhs.relevance > rhs.relevance;
-                  }
-              });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
-    {
-    matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    // в списках статуса только документы этого статуса, проверять нечего
+    return FindTopDocumentsInStatuses(policy, query, GetStatusMask(doc_status), [](int)
+                                      { return true; }, max_result_count);
+}
+
+template <typename ExecutionPolicy, typename Filter>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, std::string_view raw_query, Filter filtering_predicat,
+                                                     int max_result_count) const
+{
+    CheckMaxResultCount(max_result_count);
+    const ProcessedQuery query = ParseQuery(raw_query); // query input errors are thrown here
+    return FindTopDocumentsInStatuses(policy, query, ALL_STATUSES, MakeDocumentPredicate(filtering_predicat), max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, std::string_view raw_query, const DocumentFilter &filter,
+                                                     int max_result_count) const
+{
+    CheckMaxResultCount(max_result_count);
+    const ProcessedQuery query = ParseQuery(raw_query); // query input errors are thrown here
+    const StatusMask status_mask = filter.GetStatusMask();
+    if (!filter.HasRanges())
+    {
+        return FindTopDocumentsInStatuses(policy, query, status_mask, [](int)
+                                          { return true; }, max_result_count);
+    }
+    long long candidate_estimate = 0;
+    for (const int plus_word : query.plus_words)
+    {
+        ForEachPostingList(plus_word, status_mask, [&candidate_estimate](const PostingList &postings)
+                           { candidate_estimate += postings.GetEntryCount(); });
+    }
+    // узкий отрезок рейтингов: перескакиваем по спискам слов к его документам. Их мало, так что
+    // и при par обходим их в одном потоке
+    const long long rated_document_count = rating_index_.CountInRange(filter.GetMinRating(), filter.GetMaxRating());
+    if (rated_document_count * RATING_INDEX_RATIO < candidate_estimate)
+    {
+        thread_local std::vector<int> rated_ids;
+        rating_index_.FindInRange(filter.GetMinRating(), filter.GetMaxRating(), rated_ids);
+        return FindTopDocumentsAmong(query, status_mask, rated_ids, MakeDocumentPredicate(filter), max_result_count);
+    }
+    const int document_count = static_cast<int>(document_ids_.size());
+    // избирательный запрос дешевле проверить по кандидатам, чем пройти столбцы всех документов
+    if (candidate_estimate * SELECTION_SCAN_RATIO < document_count)
+    {
+        return FindTopDocumentsInStatuses(policy, query, status_mask, MakeDocumentPredicate(filter), max_result_count);
+    }
+    thread_local std::vector<std::uint64_t> selection;
+    selection.resize(DocumentFilter::GetSelectionWordCount(document_count));
+    filter.SelectInRanges(document_ids_.data(), document_ratings_.data(), document_count, selection.data());
+    // при par карту читают потоки-исполнители, пока вызвавший поток ждёт ответа
+    const std::uint64_t *selection_words = selection.data();
+    return FindTopDocumentsInStatuses(policy, query, status_mask, [selection_words](int internal_id)
+                                      { return DocumentFilter::IsSelected(selection_words, internal_id); }, max_result_count);
+}
+
+template <typename Filter>
+auto SearchServer::MakeDocumentPredicate(Filter filtering_predicat) const
+{
+    return [this, filtering_predicat](int internal_id)
+    {
+        return filtering_predicat(document_ids_[internal_id], document_statuses_[internal_id], document_ratings_[internal_id]);
+    };
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsInStatuses(ExecutionPolicy &&policy, const ProcessedQuery &query, StatusMask status_mask,
+                                                               DocumentPredicate document_predicate, int max_result_count) const
+{
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>)
+    {
+        return FindTopDocumentsPruned(query, status_mask, document_predicate, max_result_count);
     }
+    auto matched_documents = FindAllDocuments(policy, query, status_mask, document_predicate);
+    // сортируем только те документы, которые попадут в выдачу, остальные лишь отделяем от них
+    const auto result_end = matched_documents.begin() + std::min<std::size_t>(matched_documents.size(), max_result_count);
+    std::partial_sort(policy, matched_documents.begin(), result_end, matched_documents.end(), IsMoreRelevant);
+    matched_documents.erase(result_end, matched_documents.end());
     return matched_documents;
 }
 
 
+template <typename ExecutionPolicy>
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy &&policy, std::string_view raw_query, int document_id) const
+{
+    // заодно проверяем, что документ существует
+    const int internal_id = document_to_internal_id_.at(document_id);
+    const DocumentStatus status = document_statuses_[internal_id];
+    const ProcessedQuery query = ParseQuery(raw_query); // query input errors are thrown there
+    const auto is_in_document = [this, internal_id](int term_id)
+    {
+        return DocumentContainsWord(internal_id, term_id);
+    };
+
+    // если в документе есть хоть одно минус-слово, сразу возвращаем пустой вектор
+    std::vector<std::string_view> plus_words_in_document;
+    if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), is_in_document))
+    {
+        return {plus_words_in_document, status};
+    }
+
+    // слова запроса уже без повторов, поэтому найденные id можно сразу переводить в строки
+    std::vector<int> matched_terms(query.plus_words.size());
+    const auto matched_end = std::copy_if(policy, query.plus_words.begin(), query.plus_words.end(), matched_terms.begin(), is_in_document);
+    plus_words_in_document.resize(matched_end - matched_terms.begin());
+    std::transform(policy, matched_terms.begin(), matched_end, plus_words_in_document.begin(), [this](int term_id)
+                   { return terms_.GetTerm(term_id); });
+    // id слов выдаются в порядке добавления, а выдаём слова по алфавиту
+    std::sort(policy, plus_words_in_document.begin(), plus_words_in_document.end());
+    return {plus_words_in_document, status};
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocument(ExecutionPolicy &&policy, int document_id)
+{
+    const int internal_id = document_to_internal_id_.at(document_id);
+    StatusPostings &status_postings = word_to_document_frequency_[static_cast<int>(document_statuses_[internal_id])];
+    // у каждого слова свой список, поэтому потоки не пишут в одни и те же данные
+    std::vector<int> term_ids;
+    ForEachDocumentWord(internal_id, [&term_ids](int term_id, double)
+                        { term_ids.push_back(term_id); });
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [internal_id, &status_postings](int term_id)
+                  { status_postings.Find(term_id)->Remove(internal_id); });
+    rating_index_.Remove(document_ratings_[internal_id], internal_id);
+    for (const int term_id : term_ids)
+    {
+        UpdateLogDocumentFrequency(term_id);
+    }
+    EraseDocumentData(document_id, internal_id);
+}
+
+template <typename Function>
+void SearchServer::ForEachPostingList(int term_id, StatusMask status_mask, Function func) const
+{
+    for (int status = 0; status < STATUS_COUNT; ++status)
+    {
+        if ((status_mask >> status & 1) == 0)
+        {
+            continue;
+        }
+        if (const PostingList *postings = word_to_document_frequency_[status].Find(term_id); postings != nullptr && !postings->IsEmpty())
+        {
+            func(*postings);
+        }
+    }
+}
+
+template <typename Function>
+void SearchServer::ForEachDocumentWord(int internal_id, Function func) const
+{
+    const std::uint64_t first = forward_offsets_[internal_id];
+    const std::uint64_t last = first + forward_sizes_[internal_id];
+    for (std::uint64_t i = first; i < last; ++i)
+    {
+        func(forward_term_ids_[i], forward_frequencies_[i]);
+    }
+}
+
 // ищем все документы, которые содержат слова из запроса
 // и фильтруем результат с помощью фильтрующей лямбда-функции
-template <typename FilterFunction>
-std::vector<Document> SearchServer::FindAllDocuments(ProcessedQuery processed_query, FilterFunction filtering_predicat) const 
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const ProcessedQuery &processed_query, StatusMask status_mask, DocumentPredicate document_predicate) const 
+{
+    return FindAllDocuments(processed_query, status_mask, document_predicate, [this](int term_id)
+                            { return CalculateIDF(term_id); }, [](int)
+                            { return false; });
+}
+
+template <typename DocumentPredicate, typename IdfFunction, typename DeletedFunction>
+std::vector<Document> SearchServer::FindAllDocuments(const ProcessedQuery &processed_query, StatusMask status_mask, DocumentPredicate document_predicate,
+                                                     IdfFunction idf, DeletedFunction is_deleted) const
 {                                                                                                               
-    std::map<int, double> matched_documents;
-    for (const auto &plus_word : processed_query.plus_words)
+    // накопитель свой у каждого потока и переживает запрос, так что память под релевантность выделяется редко
+    thread_local ScoreAccumulator matched_documents;
+    thread_local ExcludedDocuments excluded_documents;
+    int candidate_estimate = 0;
+    for (const int plus_word : processed_query.plus_words)
+    {
+        ForEachPostingList(plus_word, status_mask, [&candidate_estimate](const PostingList &postings)
+                           { candidate_estimate += postings.GetDocumentCount(); });
+    }
+    const int document_capacity = static_cast<int>(document_ids_.size());
+    matched_documents.Reset(document_capacity, candidate_estimate);
+    // документы с минус-словами собираем заранее и пропускаем, не считая им релевантность
+    // документы других статусов в кандидаты не попадут, их минус-слова не нужны
+    excluded_documents.Build(GetPostingLists(processed_query.minus_words, status_mask), document_capacity, candidate_estimate);
+
+    for (const int plus_word : processed_query.plus_words)
+    {
+        double IDF = idf(plus_word);
+        ForEachPostingList(plus_word, status_mask, [&](const PostingList &postings)
+        {
+            ExcludedDocuments::Cursor excluded = excluded_documents.MakeCursor();
+            postings.ForEach([&](int internal_id, int term_count)
+            {
+                // вызываем фильтрующую лямбда-функцию
+                if (!excluded.IsExcluded(internal_id) && !is_deleted(internal_id) && document_predicate(internal_id))
+                {
+                    // считаем релевантность документа
+                    matched_documents.Add(internal_id, IDF * (term_count * document_word_weights_[internal_id]));
+                }
+            });
+        });
+    }
+    std::vector<Document> vector_of_matched_documents;
+    matched_documents.Collect([&](int internal_id, double relevance)
+    {
+        vector_of_matched_documents.push_back({document_ids_[internal_id], relevance, document_ratings_[internal_id]});
+    });
+    return vector_of_matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const ProcessedQuery &processed_query, StatusMask status_mask,
+                                                           DocumentPredicate document_predicate, int max_result_count) const
+{
+    struct Term
+    {
+        PostingList::Cursor cursor;
+        double IDF;
+        double max_score;
+        // номер слова в запросе: вклады складываются в порядке запроса, как при полном переборе
+        int query_index;
+    };
+    std::vector<Document> top_documents;
+    if (max_result_count == 0)
+    {
+        return top_documents;
+    }
+    std::vector<double> idfs;
+    int candidate_estimate = 0;
+    for (const int plus_word : processed_query.plus_words)
     {
-    if (word_to_document_frequency_.count(plus_word))
+        idfs.push_back(CalculateIDF(plus_word));
+        ForEachPostingList(plus_word, status_mask, [&candidate_estimate](const PostingList &postings)
+                           { candidate_estimate += postings.GetDocumentCount(); });
+    }
+    thread_local ExcludedDocuments excluded_documents;
+    excluded_documents.Build(GetPostingLists(processed_query.minus_words, status_mask), static_cast<int>(document_ids_.size()), candidate_estimate);
+
+    // куча худшим документом вперёд; документ, который хуже порога больше чем на погрешность сравнения,
+    // не обгонит ни одного из лучших даже по рейтингу
+    double threshold = -std::numeric_limits<double>::infinity();
+    const auto push = [&](const Document &document)
     {
-        double IDF = CalculateIDF(plus_word);
-        for (const auto &[document_id, freq] : word_to_document_frequency_.at(plus_word))
+        if (static_cast<int>(top_documents.size()) < max_result_count)
+        {
+            top_documents.push_back(document);
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        }
+        else if (IsMoreRelevant(document, top_documents.front()))
+        {
+            std::pop_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+            top_documents.back() = document;
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        }
+        if (static_cast<int>(top_documents.size()) == max_result_count)
         {
-            // вызываем фильтрующую лямбда-функцию
-            if (filtering_predicat(document_id, document_data_.at(document_id).status, document_data_.at(document_id).rating))
+            threshold = top_documents.front().relevance - MAX_RELEVANCE_DIFFERENCE;
+        }
+    };
+
+    std::vector<double> contributions(processed_query.plus_words.size());
+    std::vector<Term> terms;
+    // prefix_bounds[i] - наибольшая релевантность документа, в котором есть только слова terms[0..i]
+    std::vector<double> prefix_bounds;
+    // статусы проходятся по очереди с общей кучей: документ есть в списках только одного статуса,
+    // так что у каждого слова один курсор, а порог, набранный в одном статусе, отсекает документы следующих
+    for (int status = 0; status < STATUS_COUNT; ++status)
+    {
+        if ((status_mask >> status & 1) == 0)
+        {
+            continue;
+        }
+        terms.clear();
+        for (int i = 0; i < static_cast<int>(processed_query.plus_words.size()); ++i)
+        {
+            ForEachPostingList(processed_query.plus_words[i], GetStatusMask(static_cast<DocumentStatus>(status)), [&](const PostingList &postings)
+                               { terms.push_back({PostingList::Cursor(postings), idfs[i], idfs[i] * postings.GetMaxTermFrequency(), i}); });
+        }
+        if (terms.empty())
+        {
+            continue;
+        }
+        std::sort(terms.begin(), terms.end(), [](const Term &lhs, const Term &rhs)
+                  { return lhs.max_score < rhs.max_score; });
+        prefix_bounds.resize(terms.size());
+        double bound = 0;
+        for (std::size_t i = 0; i < terms.size(); ++i)
+        {
+            bound += terms[i].max_score;
+            prefix_bounds[i] = bound;
+        }
+        ExcludedDocuments::Cursor excluded = excluded_documents.MakeCursor();
+
+        const int term_count = static_cast<int>(terms.size());
+        // слова [0, first_essential) сами кандидатов не порождают
+        int first_essential = 0;
+        // до этого id блоки существенных слов уже проверены и не безнадёжны
+        int checked_document_id = -1;
+        while (true)
+        {
+            while (first_essential < term_count && prefix_bounds[first_essential] < threshold)
+            {
+                ++first_essential;
+            }
+            if (first_essential == term_count)
+            {
+                break;
+            }
+            int internal_id = std::numeric_limits<int>::max();
+            for (int i = first_essential; i < term_count; ++i)
+            {
+                if (!terms[i].cursor.IsEnd())
+                {
+                    internal_id = std::min(internal_id, terms[i].cursor.GetDocumentId());
+                }
+            }
+            if (internal_id == std::numeric_limits<int>::max())
+            {
+                break;
+            }
+            // оценка по текущим блокам существенных слов: если даже она не дотягивает до порога, все документы
+            // до конца ближайшего блока пропускаются не распаковываясь. Пересчитывается, только когда кандидат
+            // вышел за проверенные блоки
+            if (internal_id > checked_document_id && threshold > -std::numeric_limits<double>::infinity())
+            {
+                double block_bound = first_essential > 0 ? prefix_bounds[first_essential - 1] : 0;
+                int block_last_id = std::numeric_limits<int>::max();
+                for (int i = first_essential; i < term_count; ++i)
+                {
+                    const PostingList::Cursor &cursor = terms[i].cursor;
+                    if (!cursor.IsEnd())
+                    {
+                        block_bound += terms[i].IDF * cursor.GetBlockMaxTermFrequency();
+                        block_last_id = std::min(block_last_id, cursor.GetBlockLastDocumentId());
+                    }
+                }
+                if (block_bound < threshold)
+                {
+                    for (int i = first_essential; i < term_count; ++i)
+                    {
+                        terms[i].cursor.Advance(block_last_id + 1);
+                    }
+                    continue;
+                }
+                checked_document_id = block_last_id;
+            }
+            const bool is_accepted = !excluded.IsExcluded(internal_id) && document_predicate(internal_id);
+            const double weight = document_word_weights_[internal_id];
+            std::fill(contributions.begin(), contributions.end(), 0.0);
+            double score = 0;
+            for (int i = first_essential; i < term_count; ++i)
+            {
+                Term &term = terms[i];
+                if (!term.cursor.IsEnd() && term.cursor.GetDocumentId() == internal_id)
+                {
+                    if (is_accepted)
+                    {
+                        contributions[term.query_index] = term.IDF * (term.cursor.GetTermCount() * weight);
+                        score += contributions[term.query_index];
+                    }
+                    term.cursor.Next();
+                }
+            }
+            if (!is_accepted)
+            {
+                continue;
+            }
+            // остальные слова досчитываем от самого весомого, бросая документ, как только он безнадёжен
+            bool is_hopeless = false;
+            for (int i = first_essential - 1; i >= 0; --i)
+            {
+                Term &term = terms[i];
+                // слово оценивается по блоку, где лежал бы документ, остальные - по своим наибольшим вкладам
+                if (score + prefix_bounds[i] < threshold
+                    || score + term.IDF * term.cursor.GetMaxTermFrequencyAt(internal_id) + (i > 0 ? prefix_bounds[i - 1] : 0) < threshold)
+                {
+                    is_hopeless = true;
+                    break;
+                }
+                term.cursor.Advance(internal_id);
+                if (!term.cursor.IsEnd() && term.cursor.GetDocumentId() == internal_id)
+                {
+                    contributions[term.query_index] = term.IDF * (term.cursor.GetTermCount() * weight);
+                    score += contributions[term.query_index];
+                }
+            }
+            if (is_hopeless)
+            {
+                continue;
+            }
+            double relevance = 0;
+            for (const double contribution : contributions)
             {
-                matched_documents[document_id] += IDF * freq; // считаем релевантность документа
+                relevance += contribution;
             }
+            push({document_ids_[internal_id], relevance, document_ratings_[internal_id]});
         }
     }
-    }
-    
-    // сначала записываем все документы, содержащие слова, не являющиеся минус- , в результат. 
-    // Следующим циклом уже удалим из результата документы, содержащие минус-слова
-    for (const auto &minus_word : processed_query.minus_words)
+    std::sort(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+    return top_documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsAmong(const ProcessedQuery &processed_query, StatusMask status_mask, const std::vector<int> &internal_ids,
+                                                          DocumentPredicate document_predicate, int max_result_count) const
+{
+    struct Term
+    {
+        PostingList::Cursor cursor;
+        double IDF;
+    };
+    std::vector<double> idfs;
+    for (const int plus_word : processed_query.plus_words)
     {
-    if (word_to_document_frequency_.count(minus_word))
+        idfs.push_back(CalculateIDF(plus_word));
+    }
+    thread_local ExcludedDocuments excluded_documents;
+    excluded_documents.Build(GetPostingLists(processed_query.minus_words, status_mask), static_cast<int>(document_ids_.size()),
+                             static_cast<int>(internal_ids.size()));
+
+    std::vector<Document> matched_documents;
+    std::vector<Term> terms;
+    for (int status = 0; status < STATUS_COUNT; ++status)
     {
-        for (const auto &[document_id, freq] : word_to_document_frequency_.at(minus_word))
+        if ((status_mask >> status & 1) == 0)
+        {
+            continue;
+        }
+        // курсоры в порядке слов запроса: вклады складываются в том же порядке, что и при полном переборе
+        terms.clear();
+        for (int i = 0; i < static_cast<int>(processed_query.plus_words.size()); ++i)
+        {
+            ForEachPostingList(processed_query.plus_words[i], GetStatusMask(static_cast<DocumentStatus>(status)), [&](const PostingList &postings)
+                               { terms.push_back({PostingList::Cursor(postings), idfs[i]}); });
+        }
+        if (terms.empty())
         {
-            matched_documents.erase(document_id); // убираем из выдачи документ, содержащий минус-слово
+            continue;
+        }
+        ExcludedDocuments::Cursor excluded = excluded_documents.MakeCursor();
+        for (const int internal_id : internal_ids)
+        {
+            if (static_cast<int>(document_statuses_[internal_id]) != status || excluded.IsExcluded(internal_id) || !document_predicate(internal_id))
+            {
+                continue;
+            }
+            const double weight = document_word_weights_[internal_id];
+            bool is_matched = false;
+            double relevance = 0;
+            for (Term &term : terms)
+            {
+                term.cursor.Advance(internal_id);
+                if (!term.cursor.IsEnd() && term.cursor.GetDocumentId() == internal_id)
+                {
+                    relevance += term.IDF * (term.cursor.GetTermCount() * weight);
+                    is_matched = true;
+                }
+            }
+            if (is_matched)
+            {
+                matched_documents.push_back({document_ids_[internal_id], relevance, document_ratings_[internal_id]});
+            }
         }
     }
+    const auto result_end = matched_documents.begin() + std::min<std::size_t>(matched_documents.size(), max_result_count);
+    std::partial_sort(matched_documents.begin(), result_end, matched_documents.end(), IsMoreRelevant);
+    matched_documents.erase(result_end, matched_documents.end());
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy &&policy, const ProcessedQuery &processed_query, StatusMask status_mask,
+                                                     DocumentPredicate document_predicate) const
+{
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>)
+    {
+        return FindAllDocuments(processed_query, status_mask, document_predicate);
     }
-    std::vector<Document> vector_of_matched_documents;
-    for (const auto &[document_id, relevance] : matched_documents) // из словаря делаем вектор выдачи
+    else
     {
-        vector_of_matched_documents.push_back({document_id, relevance, document_data_.at(document_id).rating});
+        // задача - кусок списка документов одного плюс-слова, так работу делят между потоками даже однословные запросы
+        struct ScoringTask
+        {
+            const PostingList *postings;
+            double IDF;
+            int first;
+            int last;
+        };
+        std::vector<ScoringTask> tasks;
+        int plus_entry_count = 0;
+        for (const int plus_word : processed_query.plus_words)
+        {
+            const double IDF = CalculateIDF(plus_word);
+            ForEachPostingList(plus_word, status_mask, [&](const PostingList &postings)
+            {
+                for (int first = 0; first < postings.GetEntryCount(); first += PARALLEL_CHUNK_SIZE)
+                {
+                    tasks.push_back({&postings, IDF, first, std::min(first + PARALLEL_CHUNK_SIZE, postings.GetEntryCount())});
+                }
+                plus_entry_count += postings.GetEntryCount();
+            });
+        }
+        // собирается до запуска задач, дальше потоки только читают
+        ExcludedDocuments excluded_documents;
+        excluded_documents.Build(GetPostingLists(processed_query.minus_words, status_mask), static_cast<int>(document_ids_.size()), plus_entry_count);
+
+        ConcurrentMap<int, double> matched_documents(SCORE_BUCKET_COUNT);
+        std::for_each(policy, tasks.begin(), tasks.end(), [&](const ScoringTask &task)
+        {
+            ExcludedDocuments::Cursor excluded = excluded_documents.MakeCursor();
+            task.postings->ForEachInRange(task.first, task.last, [&](int internal_id, int term_count)
+            {
+                if (!excluded.IsExcluded(internal_id) && document_predicate(internal_id))
+                {
+                    matched_documents[internal_id].ref_to_value += task.IDF * (term_count * document_word_weights_[internal_id]);
+                }
+            });
+        });
+
+        std::vector<Document> vector_of_matched_documents;
+        for (const auto &[internal_id, relevance] : matched_documents.BuildOrdinaryMap())
+        {
+            vector_of_matched_documents.push_back({document_ids_[internal_id], relevance, document_ratings_[internal_id]});
+        }
+        return vector_of_matched_documents;
     }
-    return vector_of_matched_documents;
 }
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "segmented_search_server.h"
+
+#include <stdexcept>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+    bool IsBitSet(const std::vector<std::uint64_t> &bits, int index)
+    {
+        return (bits[index / 64] >> (index % 64)) & 1;
+    }
+}
+
+SegmentedSearchServer::Segment::Segment(std::shared_ptr<const SearchServer> segment_server)
+    : server(std::move(segment_server)), deleted((server->document_ids_.size() + 63) / 64), deleted_term_counts(server->terms_.Size())
+{
+}
+
+bool SegmentedSearchServer::Segment::IsDeleted(int internal_id) const
+{
+    return IsBitSet(deleted, internal_id);
+}
+
+void SegmentedSearchServer::Segment::MarkDeleted(int internal_id)
+{
+    deleted[internal_id / 64] |= std::uint64_t(1) << (internal_id % 64);
+    ++deleted_count;
+    server->ForEachDocumentWord(internal_id, [this](int term_id, double)
+                                { ++deleted_term_counts[term_id]; });
+}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words, int buffer_document_limit)
+    : stop_words_(stop_words), buffer_document_limit_(buffer_document_limit), buffer_(std::make_shared<SearchServer>(stop_words))
+{
+    if (buffer_document_limit <= 0)
+    {
+        throw std::invalid_argument("Buffer document limit must be positive"s);
+    }
+    merge_thread_ = std::thread([this]
+                                { RunMerges(); });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+    {
+        std::unique_lock lock(mutex_);
+        is_stopping_ = true;
+    }
+    merge_needed_.notify_all();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    std::unique_lock lock(mutex_);
+    // документ с этим id может лежать в замороженном сегменте, которого буфер не видит
+    if (document_ids_.count(document_id) > 0)
+    {
+        throw std::invalid_argument("Could not add document with negative or already occupied id"s);
+    }
+    buffer_->AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+    if (static_cast<int>(buffer_->document_ids_.size()) >= buffer_document_limit_)
+    {
+        FreezeBuffer();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+    std::unique_lock lock(mutex_);
+    if (document_ids_.erase(document_id) == 0)
+    {
+        throw std::out_of_range("Could not remove document with unknown id"s);
+    }
+    // буфер изменяемый, из него удаляем как обычно
+    if (buffer_->document_to_internal_id_.count(document_id) > 0)
+    {
+        buffer_->RemoveDocument(document_id);
+        return;
+    }
+    for (const auto &segment : segments_)
+    {
+        const auto it = segment->server->document_to_internal_id_.find(document_id);
+        if (it != segment->server->document_to_internal_id_.end() && !segment->IsDeleted(it->second))
+        {
+            segment->MarkDeleted(it->second);
+            break;
+        }
+    }
+    merge_needed_.notify_all();
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count) const
+{
+    return FindTopDocuments(raw_query, [status](int, DocumentStatus document_status, int)
+                            { return document_status == status; }, max_result_count);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const
+{
+    std::shared_lock lock(mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+int SegmentedSearchServer::GetSegmentCount() const
+{
+    std::shared_lock lock(mutex_);
+    return static_cast<int>(segments_.size());
+}
+
+void SegmentedSearchServer::Flush()
+{
+    std::unique_lock lock(mutex_);
+    FreezeBuffer();
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+    std::unique_lock lock(mutex_);
+    merge_finished_.wait(lock, [this]
+                         { return !is_merge_running_ && !IsMergeNeeded(); });
+}
+
+void SegmentedSearchServer::FreezeBuffer()
+{
+    if (buffer_->GetDocumentCount() > 0)
+    {
+        // документы, удалённые из буфера, уже вычищены из его списков; пометки для них не нужны
+        segments_.push_back(std::make_shared<Segment>(std::move(buffer_)));
+        merge_needed_.notify_all();
+    }
+    buffer_ = std::make_shared<SearchServer>(std::string_view(stop_words_));
+}
+
+bool SegmentedSearchServer::IsMergeNeeded() const
+{
+    std::map<int, int> level_counts;
+    for (const auto &segment : segments_)
+    {
+        if (segment->is_merging)
+        {
+            continue;
+        }
+        if (2 * segment->deleted_count > segment->server->GetDocumentCount())
+        {
+            return true;
+        }
+        if (++level_counts[segment->level] >= MERGE_FACTOR)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::shared_ptr<SegmentedSearchServer::Segment>> SegmentedSearchServer::PickMerge()
+{
+    std::vector<std::shared_ptr<Segment>> sources;
+    std::map<int, std::vector<std::shared_ptr<Segment>>> levels;
+    for (const auto &segment : segments_)
+    {
+        if (segment->is_merging)
+        {
+            continue;
+        }
+        // больше половины документов помечено: сегмент переписывается сам по себе
+        if (2 * segment->deleted_count > segment->server->GetDocumentCount())
+        {
+            sources = {segment};
+            break;
+        }
+        auto &level = levels[segment->level];
+        level.push_back(segment);
+        if (static_cast<int>(level.size()) == MERGE_FACTOR)
+        {
+            sources = level;
+            break;
+        }
+    }
+    for (const auto &segment : sources)
+    {
+        segment->is_merging = true;
+    }
+    return sources;
+}
+
+void SegmentedSearchServer::RunMerges()
+{
+    std::unique_lock lock(mutex_);
+    while (!is_stopping_)
+    {
+        const std::vector<std::shared_ptr<Segment>> sources = PickMerge();
+        if (sources.empty())
+        {
+            is_merge_running_ = false;
+            merge_finished_.notify_all();
+            merge_needed_.wait(lock);
+            continue;
+        }
+        is_merge_running_ = true;
+        std::vector<std::vector<std::uint64_t>> deleted;
+        int level = 0;
+        for (const auto &segment : sources)
+        {
+            deleted.push_back(segment->deleted);
+            level = std::max(level, segment->level + (sources.size() > 1 ? 1 : 0));
+        }
+
+        // читатели и писатели работают, пока идёт слияние
+        lock.unlock();
+        std::shared_ptr<const SearchServer> merged_server = MergeSegments(sources, deleted);
+        lock.lock();
+
+        auto merged = std::make_shared<Segment>(std::move(merged_server));
+        merged->level = level;
+        // документы, удалённые во время слияния, помечаем уже в новом сегменте
+        for (std::size_t i = 0; i < sources.size(); ++i)
+        {
+            for (std::size_t word = 0; word < deleted[i].size(); ++word)
+            {
+                for (std::uint64_t bits = sources[i]->deleted[word] & ~deleted[i][word]; bits != 0; bits &= bits - 1)
+                {
+                    const int source_internal_id = static_cast<int>(word * 64) + __builtin_ctzll(bits);
+                    const int internal_id = merged->server->document_to_internal_id_.at(sources[i]->server->document_ids_[source_internal_id]);
+                    merged->MarkDeleted(internal_id);
+                }
+            }
+        }
+        segments_.erase(std::remove_if(segments_.begin(), segments_.end(), [&sources](const std::shared_ptr<Segment> &segment)
+                                       { return std::find(sources.begin(), sources.end(), segment) != sources.end(); }),
+                        segments_.end());
+        if (merged->server->GetDocumentCount() > merged->deleted_count)
+        {
+            segments_.push_back(std::move(merged));
+        }
+    }
+}
+
+std::shared_ptr<const SearchServer> SegmentedSearchServer::MergeSegments(const std::vector<std::shared_ptr<Segment>> &sources,
+                                                                         const std::vector<std::vector<std::uint64_t>> &deleted) const
+{
+    auto merged = std::make_shared<SearchServer>(std::string_view(stop_words_));
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        const SearchServer &source = *sources[i]->server;
+        std::vector<int> term_ids(source.terms_.Size(), -1);
+        for (const auto &[document_id, internal_id] : source.document_to_internal_id_)
+        {
+            if (!IsBitSet(deleted[i], internal_id))
+            {
+                merged->CopyDocument(source, internal_id, term_ids);
+            }
+        }
+    }
+    merged->UpdateLogDocumentCount();
+    return merged;
+}
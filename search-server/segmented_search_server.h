@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// индекс из сегментов в духе LSM. Новые документы попадают в небольшой изменяемый буфер - обычный
+// SearchServer; заполненный буфер замораживается в неизменяемый сегмент. Удаление документа из сегмента
+// только ставит пометку в его битовой карте, списки документов слов не трогаются.
+// Фоновый поток сливает сегменты по уровням: когда на одном уровне набирается MERGE_FACTOR сегментов,
+// они сливаются в один сегмент следующего уровня, заодно выбрасывая помеченные документы.
+// Поиск идёт по всем сегментам с общим для индекса IDF, поэтому ответы совпадают с одним SearchServer
+class SegmentedSearchServer
+{
+public:
+    // buffer_document_limit - сколько документов набирается в буфере до заморозки
+    explicit SegmentedSearchServer(std::string_view stop_words, int buffer_document_limit = DEFAULT_BUFFER_DOCUMENT_LIMIT);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // бросает std::out_of_range, если документа нет
+    void RemoveDocument(int document_id);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename Filter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter filtering_predicat, int max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    // число неизменяемых сегментов, буфер не считается
+    int GetSegmentCount() const;
+
+    // замораживает буфер, даже если он не заполнен
+    void Flush();
+
+    // ждёт, пока фоновый поток сольёт всё, что требует политика слияния
+    void WaitForMerges();
+
+    static constexpr int DEFAULT_BUFFER_DOCUMENT_LIMIT = 4096;
+    // столько сегментов одного уровня сливаются в один
+    static constexpr int MERGE_FACTOR = 4;
+
+private:
+    friend class Tests;
+
+    struct Segment
+    {
+        std::shared_ptr<const SearchServer> server;
+        // пометки удаления по внутренним номерам сегмента
+        std::vector<std::uint64_t> deleted;
+        int deleted_count = 0;
+        // по id слова сегмента: сколько помеченных документов его содержат, для df при поиске
+        std::vector<int> deleted_term_counts;
+        // номер уровня: сегмент уровня k получен слиянием сегментов уровня k - 1
+        int level = 0;
+        bool is_merging = false;
+
+        explicit Segment(std::shared_ptr<const SearchServer> segment_server);
+
+        bool IsDeleted(int internal_id) const;
+
+        void MarkDeleted(int internal_id);
+    };
+
+    const std::string stop_words_;
+    const int buffer_document_limit_;
+
+    // читатели ищут под общей блокировкой, изменения и подмена сегментов - под исключительной
+    mutable std::shared_mutex mutex_;
+    std::shared_ptr<SearchServer> buffer_;
+    std::vector<std::shared_ptr<Segment>> segments_;
+    // id всех документов индекса: проверка повторов и число документов
+    std::set<int> document_ids_;
+
+    std::thread merge_thread_;
+    std::condition_variable_any merge_needed_;
+    std::condition_variable_any merge_finished_;
+    bool is_stopping_ = false;
+    bool is_merge_running_ = false;
+
+    // под исключительной блокировкой
+    void FreezeBuffer();
+
+    // сегменты, которые пора слить, или пустой список; помечает их is_merging. Под исключительной блокировкой
+    std::vector<std::shared_ptr<Segment>> PickMerge();
+
+    void RunMerges();
+
+    // есть ли работа для PickMerge; под блокировкой
+    bool IsMergeNeeded() const;
+
+    // сливает документы сегментов, не помеченные в deleted, в новый сервер; блокировка не нужна - сегменты не меняются
+    std::shared_ptr<const SearchServer> MergeSegments(const std::vector<std::shared_ptr<Segment>>& sources,
+                                                      const std::vector<std::vector<std::uint64_t>>& deleted) const;
+
+    // под общей блокировкой
+    template <typename Filter>
+    std::vector<Document> FindAllDocuments(std::string_view raw_query, Filter filtering_predicat) const;
+};
+
+template <typename Filter>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, Filter filtering_predicat, int max_result_count) const
+{
+    if (max_result_count < 0)
+    {
+        throw std::invalid_argument("Result document count must not be negative"s);
+    }
+    std::vector<Document> matched_documents;
+    {
+        std::shared_lock lock(mutex_);
+        matched_documents = FindAllDocuments(raw_query, filtering_predicat);
+    }
+    const auto result_end = matched_documents.begin() + std::min<std::size_t>(matched_documents.size(), max_result_count);
+    std::partial_sort(matched_documents.begin(), result_end, matched_documents.end(), SearchServer::IsMoreRelevant);
+    matched_documents.erase(result_end, matched_documents.end());
+    return matched_documents;
+}
+
+template <typename Filter>
+std::vector<Document> SegmentedSearchServer::FindAllDocuments(std::string_view raw_query, Filter filtering_predicat) const
+{
+    // запрос разбирается в словах каждого сегмента; некорректный запрос бросает исключение уже на буфере
+    std::vector<const SearchServer *> servers = {buffer_.get()};
+    std::vector<const Segment *> segments = {nullptr};
+    for (const auto &segment : segments_)
+    {
+        servers.push_back(segment->server.get());
+        segments.push_back(segment.get());
+    }
+    std::vector<SearchServer::ProcessedQuery> queries;
+    for (const SearchServer *server : servers)
+    {
+        queries.push_back(server->ParseQuery(raw_query));
+    }
+
+    // общий IDF: df слова - сумма по сегментам без помеченных документов, N - все документы индекса
+    std::map<std::string_view, int> document_frequencies;
+    for (std::size_t i = 0; i < servers.size(); ++i)
+    {
+        for (const int term_id : queries[i].plus_words)
+        {
+            int document_frequency = servers[i]->GetDocumentFrequency(term_id);
+            if (segments[i] != nullptr)
+            {
+                document_frequency -= segments[i]->deleted_term_counts[term_id];
+            }
+            document_frequencies[servers[i]->terms_.GetTerm(term_id)] += document_frequency;
+        }
+    }
+    std::map<std::string_view, double> idfs;
+    for (const auto &[word, document_frequency] : document_frequencies)
+    {
+        // та же формула, что в SearchServer::CalculateIDF, чтобы релевантность совпадала до бита
+        idfs[word] = document_frequency > 0 ? std::log(static_cast<double>(document_ids_.size())) - std::log(static_cast<double>(document_frequency)) : 0;
+    }
+
+    // живой документ есть только в одном сегменте, так что ответы сегментов просто складываются
+    std::vector<Document> matched_documents;
+    for (std::size_t i = 0; i < servers.size(); ++i)
+    {
+        const SearchServer &server = *servers[i];
+        const Segment *segment = segments[i];
+        const auto idf = [&server, &idfs](int term_id)
+        {
+            return idfs.at(server.terms_.GetTerm(term_id));
+        };
+        const auto is_deleted = [segment](int internal_id)
+        {
+            return segment != nullptr && segment->IsDeleted(internal_id);
+        };
+        const std::vector<Document> segment_documents = server.FindAllDocuments(queries[i], SearchServer::ALL_STATUSES, server.MakeDocumentPredicate(filtering_predicat),
+                                                                                idf, is_deleted);
+        matched_documents.insert(matched_documents.end(), segment_documents.begin(), segment_documents.end());
+    }
+    return matched_documents;
+}
@@ -0,0 +1,85 @@
+#include "snapshot_search_server.h"
+
+#include <atomic>
+#include <thread>
+
+SnapshotSearchServer::SnapshotSearchServer(SearchServer server)
+    : current_(std::make_shared<SearchServer>(std::move(server))), standby_(std::make_shared<SearchServer>(*current_))
+{
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const
+{
+    return std::atomic_load(&current_);
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    // изменение повторяется позже, поэтому текст копируется
+    Apply([document_id, text = std::string(document), status, ratings](SearchServer &server)
+          { server.AddDocument(document_id, text, status, ratings); });
+}
+
+std::vector<AddDocumentError> SnapshotSearchServer::AddDocuments(const std::vector<DocumentToAdd> &documents)
+{
+    std::vector<std::string> texts;
+    texts.reserve(documents.size());
+    for (const DocumentToAdd &document : documents)
+    {
+        texts.emplace_back(document.text);
+    }
+    // тексты DocumentToAdd смотрят в копии, которые живут в самом изменении
+    return Apply([documents = documents, texts = std::move(texts)](SearchServer &server) mutable
+                 {
+                     for (std::size_t i = 0; i < documents.size(); ++i)
+                     {
+                         documents[i].text = texts[i];
+                     }
+                     return server.AddDocuments(documents);
+                 });
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id)
+{
+    Apply([document_id](SearchServer &server)
+          { server.RemoveDocument(document_id); });
+}
+
+void SnapshotSearchServer::RemoveDocuments(const std::vector<int> &document_ids)
+{
+    Apply([document_ids](SearchServer &server)
+          { server.RemoveDocuments(document_ids); });
+}
+
+SearchServer &SnapshotSearchServer::PrepareStandby()
+{
+    // новых читателей у standby_ не появится: он не опубликован, остаются только взявшие его раньше
+    const auto deadline = std::chrono::steady_clock::now() + MAX_READER_WAIT;
+    while (standby_.use_count() > 1 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+    if (standby_.use_count() > 1)
+    {
+        // читатель задержался: оставляем ему старую версию, а сами начинаем с копии текущей
+        standby_ = std::make_shared<SearchServer>(*std::atomic_load(&current_));
+        pending_updates_.clear();
+    }
+    else
+    {
+        // последний читатель уменьшил счётчик после всех своих чтений; не даём нашим записям обогнать их
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (auto &update : pending_updates_)
+        {
+            update(*standby_);
+        }
+        pending_updates_.clear();
+    }
+    return *standby_;
+}
+
+void SnapshotSearchServer::Publish(std::function<void(SearchServer &)> update)
+{
+    standby_ = std::atomic_exchange(&current_, std::move(standby_));
+    pending_updates_.push_back(std::move(update));
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// SearchServer, который читают из многих потоков во время записи. Читатель берёт снимок - неизменяемую
+// версию сервера - без блокировок и ищет в нём сколько угодно, запись его не трогает.
+// Версий две: пока читатели работают с опубликованной, писатель меняет вторую и публикует её атомарной
+// заменой указателя. Прежняя версия догоняет новую теми же изменениями, когда её отпустят читатели,
+// поэтому запись не копирует индекс. Копия делается, только если читатель держит старый снимок дольше
+// MAX_READER_WAIT; отпущенные копии освобождает последний читатель
+class SnapshotSearchServer
+{
+public:
+    explicit SnapshotSearchServer(SearchServer server);
+
+    // текущая версия; держать снимок стоит только на время запроса, иначе следующая запись скопирует индекс
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // публикует результат update(SearchServer&) как одну новую версию и возвращает то, что вернул update.
+    // update вызывается второй раз для прежней версии, поэтому должен давать тот же результат и не ссылаться
+    // на данные, которые к тому времени умрут. Если update бросил исключение, сервер должен остаться прежним
+    template <typename Update>
+    auto Apply(Update update);
+
+private:
+    friend class Tests;
+
+    // опубликованная версия; читается и заменяется только через std::atomic_load / std::atomic_store
+    std::shared_ptr<SearchServer> current_;
+    // вторая версия, её видит только писатель; отстаёт от current_ на изменения из pending_updates_
+    std::shared_ptr<SearchServer> standby_;
+    std::vector<std::function<void(SearchServer&)>> pending_updates_;
+    // писатели по очереди
+    std::mutex write_mutex_;
+
+    // сколько писатель ждёт, пока читатели отпустят прежнюю версию, прежде чем скопировать текущую
+    static constexpr std::chrono::milliseconds MAX_READER_WAIT{50};
+
+    // догоняет standby_ до текущей версии и возвращает его для изменения; вызывается под write_mutex_
+    SearchServer& PrepareStandby();
+
+    // публикует standby_, прежняя версия становится запасной и должна повторить update
+    void Publish(std::function<void(SearchServer&)> update);
+};
+
+template <typename Update>
+auto SnapshotSearchServer::Apply(Update update)
+{
+    std::lock_guard guard(write_mutex_);
+    SearchServer &next = PrepareStandby();
+    if constexpr (std::is_void_v<std::invoke_result_t<Update&, SearchServer&>>)
+    {
+        update(next);
+        Publish([update](SearchServer &server) mutable
+                { update(server); });
+    }
+    else
+    {
+        auto result = update(next);
+        Publish([update](SearchServer &server) mutable
+                { update(server); });
+        return result;
+    }
+}
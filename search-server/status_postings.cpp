@@ -0,0 +1,87 @@
+#include "status_postings.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals::string_literals;
+
+StatusPostings::StatusPostings(bool is_dense) : is_dense_(is_dense)
+{
+}
+
+bool StatusPostings::IsDense() const
+{
+    return is_dense_;
+}
+
+const PostingList *StatusPostings::Find(int term_id) const
+{
+    if (is_dense_)
+    {
+        return static_cast<std::size_t>(term_id) < dense_.size() ? &dense_[term_id] : nullptr;
+    }
+    const auto it = sparse_.find(term_id);
+    return it != sparse_.end() ? &it->second : nullptr;
+}
+
+PostingList *StatusPostings::Find(int term_id)
+{
+    return const_cast<PostingList *>(static_cast<const StatusPostings &>(*this).Find(term_id));
+}
+
+PostingList &StatusPostings::Get(int term_id)
+{
+    if (!is_dense_)
+    {
+        return sparse_[term_id];
+    }
+    if (term_id >= static_cast<int>(dense_.size()))
+    {
+        dense_.resize(term_id + 1);
+    }
+    return dense_[term_id];
+}
+
+std::size_t StatusPostings::GetListCount() const
+{
+    return is_dense_ ? dense_.size() : sparse_.size();
+}
+
+void StatusPostings::Save(IndexWriter &writer) const
+{
+    std::uint64_t list_count = 0;
+    ForEach([&list_count](int, const PostingList &postings)
+            { list_count += !postings.IsEmpty(); });
+    writer.Write(list_count);
+    ForEach([&writer](int term_id, const PostingList &postings)
+            {
+                if (!postings.IsEmpty())
+                {
+                    writer.Write(static_cast<std::int32_t>(term_id));
+                    postings.Save(writer);
+                }
+            });
+}
+
+StatusPostings StatusPostings::Open(IndexReader &reader, bool is_dense, int term_count)
+{
+    StatusPostings status_postings(is_dense);
+    const std::uint64_t list_count = reader.Read<std::uint64_t>();
+    if (list_count > static_cast<std::uint64_t>(term_count))
+    {
+        throw std::runtime_error("Index file has more posting lists than terms"s);
+    }
+    int previous_term_id = -1;
+    for (std::uint64_t i = 0; i < list_count; ++i)
+    {
+        const int term_id = reader.Read<std::int32_t>();
+        if (term_id <= previous_term_id || term_id >= term_count)
+        {
+            throw std::runtime_error("Index file has a posting list of an unknown term"s);
+        }
+        previous_term_id = term_id;
+        status_postings.Get(term_id) = PostingList::Open(reader);
+    }
+    return status_postings;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "posting_list.h"
+#include "index_file.h"
+
+// списки документов слов одного статуса по id слова. Плотное хранение - вектор до последнего слова,
+// встречавшегося в документах статуса: список находится по индексу. Разреженное - только слова,
+// у которых есть документы статуса: для редких статусов не заводится пустой список на каждое слово словаря
+class StatusPostings
+{
+public:
+    explicit StatusPostings(bool is_dense = false);
+
+    bool IsDense() const;
+
+    // список слова или nullptr, если его не заводили
+    const PostingList* Find(int term_id) const;
+    PostingList* Find(int term_id);
+
+    // возвращает список слова, заводя пустой, если его нет
+    PostingList& Get(int term_id);
+
+    // число заведённых списков, в том числе пустых
+    std::size_t GetListCount() const;
+
+    // func(term_id, const PostingList&) для заведённых списков по возрастанию id слова
+    template <typename Function>
+    void ForEach(Function func) const;
+
+    // пишет только непустые списки, вместе с id слова
+    void Save(IndexWriter& writer) const;
+    // читает списки, записанные Save; бросает std::runtime_error, если id слова не меньше term_count
+    // или id идут не по возрастанию
+    static StatusPostings Open(IndexReader& reader, bool is_dense, int term_count);
+
+private:
+    bool is_dense_;
+    std::vector<PostingList> dense_;
+    std::map<int, PostingList> sparse_;
+};
+
+template <typename Function>
+void StatusPostings::ForEach(Function func) const
+{
+    if (is_dense_)
+    {
+        for (int term_id = 0; term_id < static_cast<int>(dense_.size()); ++term_id)
+        {
+            func(term_id, dense_[term_id]);
+        }
+    }
+    else
+    {
+        for (const auto &[term_id, postings] : sparse_)
+        {
+            func(term_id, postings);
+        }
+    }
+}
@@ -1,28 +1,24 @@
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(const std::string& text)
+std::vector<std::string_view> SplitIntoWords(std::string_view text)
 {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text)
+    std::vector<std::string_view> words;
+    std::size_t word_begin = 0;
+    for (std::size_t pos = 0; pos < text.size(); ++pos)
     {
-        if (c == ' ')
+        if (text[pos] == ' ')
         {
-            if (!word.empty())
+            if (pos > word_begin)
             {
-                words.push_back(word);
-                word.clear();
+                words.push_back(text.substr(word_begin, pos - word_begin));
             }
-        }
-        else
-        {
-            word += c;
+            word_begin = pos + 1;
         }
     }
-    if (!word.empty())
+    if (text.size() > word_begin)
     {
-        words.push_back(word);
+        words.push_back(text.substr(word_begin));
     }
 
     return words;
-}
\ No newline at end of file
+}
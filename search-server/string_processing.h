@@ -2,17 +2,19 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <set>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+// слова возвращаются как срезы переданной строки, поэтому она должна жить дольше результата
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
-    for (const std::string& str : strings) {
-        if (!str.empty()) {
-            non_empty_strings.insert(str);
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
+    for (const auto& str : strings) {
+        if (!std::string_view(str).empty()) {
+            non_empty_strings.emplace(str);
         }
     }
     return non_empty_strings;
-}
\ No newline at end of file
+}
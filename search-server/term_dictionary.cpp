@@ -0,0 +1,85 @@
+#include "term_dictionary.h"
+
+#include <iterator>
+#include <stdexcept>
+
+using namespace std::literals::string_literals;
+
+TermDictionary::TermDictionary(const TermDictionary &other)
+{
+    // ключи other.term_to_id_ смотрят в строки other, поэтому индекс строим заново
+    for (const std::string_view term : other.terms_)
+    {
+        Intern(term);
+    }
+}
+
+TermDictionary &TermDictionary::operator=(const TermDictionary &rhs)
+{
+    if (this != &rhs)
+    {
+        TermDictionary copy(rhs);
+        owned_terms_.swap(copy.owned_terms_);
+        terms_.swap(copy.terms_);
+        term_to_id_.swap(copy.term_to_id_);
+    }
+    return *this;
+}
+
+TermDictionary::TermDictionary(std::vector<std::string_view> terms, const std::vector<int> &sorted_term_ids)
+    : terms_(std::move(terms))
+{
+    if (sorted_term_ids.size() != terms_.size())
+    {
+        throw std::invalid_argument("Sorted term ids must list every term"s);
+    }
+    for (const int term_id : sorted_term_ids)
+    {
+        // вставка в конец с подсказкой - амортизированно O(1)
+        const auto it = term_to_id_.emplace_hint(term_to_id_.end(), terms_.at(term_id), term_id);
+        if (std::next(it) != term_to_id_.end() || it->second != term_id)
+        {
+            throw std::invalid_argument("Terms must be unique and listed in sorted order"s);
+        }
+    }
+}
+
+int TermDictionary::Intern(std::string_view term)
+{
+    if (const auto it = term_to_id_.find(term); it != term_to_id_.end())
+    {
+        return it->second;
+    }
+    const int term_id = static_cast<int>(terms_.size());
+    const std::string &stored_term = owned_terms_.emplace_back(term);
+    terms_.push_back(stored_term);
+    term_to_id_.emplace(stored_term, term_id);
+    return term_id;
+}
+
+int TermDictionary::Find(std::string_view term) const
+{
+    const auto it = term_to_id_.find(term);
+    return it == term_to_id_.end() ? NOT_FOUND : it->second;
+}
+
+std::string_view TermDictionary::GetTerm(int term_id) const
+{
+    return terms_.at(term_id);
+}
+
+int TermDictionary::Size() const
+{
+    return static_cast<int>(terms_.size());
+}
+
+std::vector<int> TermDictionary::GetSortedTermIds() const
+{
+    std::vector<int> sorted_term_ids;
+    sorted_term_ids.reserve(term_to_id_.size());
+    for (const auto &[term, term_id] : term_to_id_)
+    {
+        sorted_term_ids.push_back(term_id);
+    }
+    return sorted_term_ids;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <map>
+#include <vector>
+
+// словарь терминов: каждому слову при первой встрече выдаётся компактный целочисленный id,
+// сама строка хранится в единственном экземпляре
+class TermDictionary
+{
+public:
+    static constexpr int NOT_FOUND = -1;
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& rhs);
+    // перемещение забирает узлы deque целиком: строки остаются на месте, и ключи индекса не перестраиваются.
+    // Не noexcept: перемещение std::deque в libstdc++ выделяет память под пустой остаток и может бросить bad_alloc
+    TermDictionary(TermDictionary&& other) = default;
+    TermDictionary& operator=(TermDictionary&& rhs) = default;
+
+    // словарь над строками, которые живут снаружи (в отображённом файле индекса) и не копируются.
+    // terms - слова по id, sorted_term_ids - id в алфавитном порядке слов, с ним индекс строится за линейное время
+    TermDictionary(std::vector<std::string_view> terms, const std::vector<int>& sorted_term_ids);
+
+    // возвращает id слова, добавляя его в словарь, если слово встретилось впервые
+    int Intern(std::string_view term);
+
+    // возвращает id слова или NOT_FOUND, если такого слова в словаре нет
+    int Find(std::string_view term) const;
+
+    std::string_view GetTerm(int term_id) const;
+
+    int Size() const;
+
+    // id всех слов в алфавитном порядке слов
+    std::vector<int> GetSortedTermIds() const;
+
+private:
+    // deque не инвалидирует ссылки на элементы при push_back, поэтому ключи-string_view остаются валидными
+    std::deque<std::string> owned_terms_;
+    // слова по id: строки из owned_terms_ или внешние
+    std::vector<std::string_view> terms_;
+    std::map<std::string_view, int> term_to_id_;
+};
@@ -3,12 +3,12 @@
 
 using namespace std::literals::string_literals;
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status) {
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status) {
     std::cout << "{ "s
          << "document_id = "s << document_id << ", "s
          << "status = "s << static_cast<int>(status) << ", "s
          << "words ="s;
-    for (const std::string& word : words) {
+    for (const std::string_view word : words) {
         std::cout << ' ' << word;
     }
     std::cout << "}"s << std::endl;
@@ -2,11 +2,12 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 
 #include "document.h"
 #include "search_server.h"
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
  
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document,
                  DocumentStatus status, const std::vector<int>& ratings);
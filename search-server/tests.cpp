@@ -5,14 +5,40 @@
 #include <map>
 #include <set>
 #include <string>
+#include <string_view>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <memory>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <limits>
 
 #include "search_server.h"
 #include "document.h"
 #include "remove_duplicates.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "index_file.h"
+#include "bit_packing.h"
+#include "string_processing.h"
+#include "concurrent_map.h"
+#include "score_accumulator.h"
+#include "excluded_documents.h"
+#include "document_filter.h"
+#include "rating_index.h"
+#include "process_queries.h"
+#include "write_ahead_log.h"
+#include "durable_search_server.h"
+#include "query_result_cache.h"
+#include "snapshot_search_server.h"
+#include "segmented_search_server.h"
 using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
 
 
 
@@ -254,7 +280,7 @@ void Tests::TestDocumentMatching()
         SearchServer server(""s);
         server.AddDocument(first_doc_id, first_content, DocumentStatus::ACTUAL, first_ratings);
         const auto [matched_words, document_status] = server.MatchDocument("cat city"s, first_doc_id);
-        std::vector<std::string> expected_matched_words {"cat"s, "city"s};
+        std::vector<std::string_view> expected_matched_words {"cat"sv, "city"sv};
         ASSERT_EQUAL_HINT(matched_words, expected_matched_words, 
         "Matching of a query with two words from a doc should return them both in an order like in their parent doc"s);
         ASSERT_EQUAL_HINT(document_status, DocumentStatus::ACTUAL, "Doc status shouldn't change after matching"s);
@@ -264,7 +290,7 @@ void Tests::TestDocumentMatching()
         SearchServer server("in the"s);
         server.AddDocument(first_doc_id, first_content, DocumentStatus::ACTUAL, first_ratings);
         const auto [matched_words, document_status] = server.MatchDocument("cat in the city"s, first_doc_id);
-        std::vector<std::string> expected_matched_words {"cat"s, "city"s};
+        std::vector<std::string_view> expected_matched_words {"cat"sv, "city"sv};
         ASSERT_EQUAL_HINT(matched_words, expected_matched_words, 
         "Matching of 2 stop and 2 plus word query should return plus words in order like in their parent doc"s);
         ASSERT_EQUAL_HINT(document_status, DocumentStatus::ACTUAL, "Doc status shouldn't change after matching"s);
@@ -277,6 +303,17 @@ void Tests::TestDocumentMatching()
         ASSERT_HINT(matched_words.empty(), "Matching of a query including minus word shouldn't return anything"s);
         ASSERT_EQUAL_HINT(document_status, DocumentStatus::ACTUAL, "Doc status shouldn't change after matching"s);
     }
+    // parallel matching
+    {
+        SearchServer server("in the"s);
+        server.AddDocument(first_doc_id, first_content, DocumentStatus::BANNED, first_ratings);
+        const auto [matched_words, document_status] = server.MatchDocument(std::execution::par, "city cat dog cat in"s, first_doc_id);
+        std::vector<std::string_view> expected_matched_words {"cat"sv, "city"sv};
+        ASSERT_EQUAL_HINT(matched_words, expected_matched_words, "Parallel matching should return each found word once, in alphabetical order"s);
+        ASSERT_EQUAL_HINT(document_status, DocumentStatus::BANNED, "Parallel matching should return the doc status"s);
+        const auto [minus_matched_words, minus_status] = server.MatchDocument(std::execution::par, "cat -dog -city"s, first_doc_id);
+        ASSERT_HINT(minus_matched_words.empty(), "Parallel matching of a query including minus word shouldn't return anything"s);
+    }
 }
 // тест корректного вычисления релевантности
 void Tests::TestCorrectRelevanceCalculation()
@@ -472,7 +509,7 @@ void Tests::TestSprint6Functional()
         auto answer = server.GetWordFrequencies(second_doc_id);
         ASSERT_HINT(answer.empty(), "Answer map should be empty for non-existing document"s);
 
-        const std::map<std::string, double> expected_answer{{"cat"s, 0.25}, {"in"s, 0.25}, {"the"s, 0.25}, {"city"s, 0.25}};
+        const std::map<std::string_view, double> expected_answer{{"cat"sv, 0.25}, {"in"sv, 0.25}, {"the"sv, 0.25}, {"city"sv, 0.25}};
         answer = server.GetWordFrequencies(first_doc_id);
         ASSERT_EQUAL_HINT(expected_answer.size(), answer.size(), "Maps' sizes should match"s);
         for (const auto& [word, freq] : answer)
@@ -487,10 +524,10 @@ void Tests::TestSprint6Functional()
         server.AddDocument(first_doc_id, first_content, DocumentStatus::ACTUAL, first_ratings);
         server.RemoveDocument(first_doc_id);
         ASSERT_HINT(
-        (server.word_to_document_frequency_.count("cat"s) == 0) &&
-        (server.document_data_.count(first_doc_id) == 0) &&
+        server.GetDocumentFrequency(server.terms_.Find("cat"s)) == 0 &&
+        (server.document_to_internal_id_.count(first_doc_id) == 0) &&
         (server.added_documents_.count(first_doc_id) == 0) &&
-        (server.doc_id_to_word_frequency_.count(first_doc_id) == 0) &&
+        (server.forward_sizes_[0] == 0) &&
         (server.begin() == server.end()), 
         "Document should be erased from all structures"s
         );
@@ -520,6 +557,1523 @@ void Tests::TestSprint6Functional()
     }
 }   
 
+// тест словаря терминов: одно слово - один id, копия сервера не ссылается на строки оригинала
+void Tests::TestTermDictionary()
+{
+    {
+        TermDictionary terms;
+        const int cat_id = terms.Intern("cat"s);
+        const int city_id = terms.Intern("city"s);
+        ASSERT_EQUAL_HINT(terms.Intern("cat"s), cat_id, "The same word should always get the same id"s);
+        ASSERT_HINT(cat_id != city_id, "Different words should get different ids"s);
+        ASSERT_EQUAL_HINT(terms.Find("dog"s), TermDictionary::NOT_FOUND, "Unknown word should not be found"s);
+        ASSERT_EQUAL_HINT(terms.GetTerm(city_id), "city"sv, "Id should map back to the word"s);
+        ASSERT_EQUAL_HINT(terms.Size(), 2, "Dictionary should store every word once"s);
+
+        const char *stored_city = terms.GetTerm(city_id).data();
+        TermDictionary moved(std::move(terms));
+        ASSERT_EQUAL_HINT(moved.GetTerm(city_id).data(), stored_city, "Move should keep the stored words in place"s);
+        ASSERT_EQUAL(moved.Find("cat"s), cat_id);
+        TermDictionary assigned;
+        assigned = std::move(moved);
+        ASSERT_EQUAL(assigned.Find("city"s), city_id);
+        ASSERT_EQUAL(assigned.Intern("dog"s), 2);
+    }
+    {
+        auto server = std::make_unique<SearchServer>(""s);
+        server->AddDocument(42, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+        server->AddDocument(1, "orange cat near the library"s, DocumentStatus::ACTUAL, {4, 5, 6});
+        const SearchServer copy = *server;
+        server.reset();
+        const std::vector<Document> result = copy.FindTopDocuments("city -orange"s);
+        ASSERT_EQUAL_HINT(copy.GetWordFrequencies(42).count("city"sv), 1u, "Copied server should keep its own words"s);
+        ASSERT_EQUAL_HINT(result.size(), 1u, "Copied server should find documents by its own dictionary"s);
+        ASSERT_EQUAL_HINT(result[0].id, 42, "Copied server should find the right document"s);
+    }
+}
+
+// тест списка документов слова: порядок id, ленивое удаление и повторное добавление
+void Tests::TestPostingList()
+{
+    PostingList postings;
+    postings.Add(5, 2);
+    postings.Add(1, 1);
+    postings.Add(9, 3);
+    std::vector<int> ids;
+    postings.ForEach([&ids](int document_id, int) { ids.push_back(document_id); });
+    ASSERT_EQUAL_HINT(ids, (std::vector<int>{1, 5, 9}), "Documents should be kept sorted by id"s);
+
+    postings.Remove(5);
+    postings.Remove(42);
+    ASSERT_EQUAL_HINT(postings.GetDocumentCount(), 2, "Removed document should not be counted"s);
+    ASSERT_HINT(!postings.Contains(5), "Removed document should not be found"s);
+
+    postings.Add(5, 4);
+    int count_of_5 = 0;
+    postings.ForEach([&count_of_5](int document_id, int term_count) { if (document_id == 5) count_of_5 = term_count; });
+    ASSERT_EQUAL_HINT(count_of_5, 4, "Re-added document should get its new term count"s);
+
+    postings.Remove(1);
+    postings.Remove(5);
+    postings.Remove(9);
+    ASSERT_HINT(postings.IsEmpty(), "List should be empty after all documents are removed"s);
+}
+
+// тест упаковки блоков: SSE и скалярная распаковка совпадают и восстанавливают исходные числа при любой ширине
+void Tests::TestBitPacking()
+{
+    std::uint32_t ids[PACKED_BLOCK_SIZE];
+    std::uint32_t deltas[PACKED_BLOCK_SIZE];
+    std::uint32_t packed[PACKED_BLOCK_SIZE];
+    std::uint32_t unpacked[PACKED_BLOCK_SIZE];
+    std::uint32_t unpacked_scalar[PACKED_BLOCK_SIZE];
+    for (const std::uint32_t step : {0u, 1u, 3u, 1000u, 40'000'000u})
+    {
+        const std::uint32_t base = 17;
+        for (int i = 0; i < PACKED_BLOCK_SIZE; ++i)
+        {
+            ids[i] = base + step * i + (i % 5 == 0 ? step : 0);
+        }
+        EncodeDeltas(ids, base, deltas);
+        const int bit_width = GetRequiredBitWidth(deltas);
+        PackBlock(deltas, bit_width, packed);
+        UnpackBlock(packed, bit_width, unpacked);
+        UnpackBlockScalar(packed, bit_width, unpacked_scalar);
+        ASSERT_HINT(std::equal(unpacked, unpacked + PACKED_BLOCK_SIZE, deltas), "Unpacked values should match packed ones"s);
+        ASSERT_HINT(std::equal(unpacked_scalar, unpacked_scalar + PACKED_BLOCK_SIZE, deltas), "Scalar unpacking should match"s);
+        DecodeDeltas(unpacked, base);
+        DecodeDeltasScalar(unpacked_scalar, base);
+        ASSERT_HINT(std::equal(unpacked, unpacked + PACKED_BLOCK_SIZE, ids), "Ids should be restored from deltas"s);
+        ASSERT_HINT(std::equal(unpacked_scalar, unpacked_scalar + PACKED_BLOCK_SIZE, ids), "Scalar delta decoding should match"s);
+    }
+    std::fill(ids, ids + PACKED_BLOCK_SIZE, ~std::uint32_t{0});
+    ASSERT_EQUAL(GetRequiredBitWidth(ids), 32);
+    PackBlock(ids, 32, packed);
+    UnpackBlock(packed, 32, unpacked);
+    ASSERT_HINT(std::equal(unpacked, unpacked + PACKED_BLOCK_SIZE, ids), "Full-width values should survive packing"s);
+}
+
+// тест сжатого списка на нескольких блоках: совпадает с обычным словарём после добавлений и удалений
+void Tests::TestCompressedPostingList()
+{
+    PostingList postings;
+    std::map<int, int> expected;
+    for (int document_id = 0; document_id < 1000; document_id += 1 + document_id % 7)
+    {
+        postings.Add(document_id, 1 + document_id % 3);
+        expected[document_id] = 1 + document_id % 3;
+    }
+    // вставка в середину сжатого блока и удаления в блоках и в хвосте
+    postings.Add(501, 9);
+    expected[501] += 9;
+    for (const int document_id : {0, 2, 501, 997, 998, 2000})
+    {
+        postings.Remove(document_id);
+        expected.erase(document_id);
+    }
+    const auto assert_matches = [&](const std::string &hint)
+    {
+        std::map<int, int> actual;
+        postings.ForEach([&actual](int document_id, int term_count) { actual[document_id] = term_count; });
+        ASSERT_HINT(actual == expected, hint);
+        ASSERT_EQUAL_HINT(postings.GetDocumentCount(), static_cast<int>(expected.size()), hint);
+        for (const auto &[document_id, term_count] : expected)
+        {
+            ASSERT_HINT(postings.Contains(document_id), hint);
+        }
+    };
+    assert_matches("Compressed list should match reference after edits"s);
+
+    std::vector<int> half;
+    for (const auto &[document_id, term_count] : expected)
+    {
+        if (document_id % 2 == 0)
+        {
+            half.push_back(document_id);
+        }
+    }
+    postings.Remove(half);
+    for (const int document_id : half)
+    {
+        expected.erase(document_id);
+    }
+    assert_matches("Compressed list should match reference after compaction"s);
+    ASSERT_HINT(!postings.Contains(4), "Removed document should not be found"s);
+
+    // список из файла распаковывается при чтении: целый читается как был, испорченный хвост отвергается
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test_postings.idx").string();
+    {
+        IndexWriter writer(path);
+        postings.Save(writer);
+        writer.Finish();
+    }
+    {
+        const MappedFile file(path);
+        IndexReader reader(file);
+        postings = PostingList::Open(reader);
+        assert_matches("Opened list should match reference"s);
+    }
+    // заголовок и массивы в порядке PostingList::Save: список без блоков с хвостом из двух записей
+    const auto opens = [&path](int last_document_id, const std::vector<std::uint8_t> &tail)
+    {
+        {
+            IndexWriter writer(path);
+            writer.Write(2);
+            writer.Write(last_document_id);
+            writer.Write(0);
+            writer.Write(1.0f);
+            writer.Write(1.0f);
+            writer.WriteArray(std::vector<std::uint32_t>{});
+            writer.WriteArray(std::vector<std::uint32_t>{});
+            writer.WriteArray(tail);
+            writer.WriteArray(std::vector<std::uint64_t>{});
+            writer.Finish();
+        }
+        const MappedFile file(path);
+        IndexReader reader(file);
+        try
+        {
+            PostingList::Open(reader);
+        }
+        catch (const std::runtime_error &)
+        {
+            return false;
+        }
+        return true;
+    };
+    // пары (разность id, число вхождений минус один)
+    ASSERT_HINT(opens(7, {3, 0, 4, 0}), "Valid tail should open"s);
+    ASSERT_HINT(!opens(3, {3, 0, 0, 0}), "Repeated id should be rejected"s);
+    ASSERT_HINT(!opens(9, {3, 0, 4, 0}), "Last id that differs from the decoded one should be rejected"s);
+    ASSERT_HINT(!opens(7, {3, 0, 0x84, 0x80, 0x80, 0x80, 0x80, 0x00, 0}), "Varint longer than 5 bytes should be rejected"s);
+    ASSERT_HINT(!opens(7, {3, 0, 0xFD, 0xFF, 0xFF, 0xFF, 0x07, 0}), "Id past int should be rejected"s);
+    std::filesystem::remove(path);
+}
+
+// тест разбиения на слова: лишние пробелы пропускаются, слова ссылаются в исходную строку
+void Tests::TestSplitIntoWords()
+{
+    const std::string text = "  cat  in the city "s;
+    const std::vector<std::string_view> words = SplitIntoWords(text);
+    ASSERT_EQUAL_HINT(words, (std::vector<std::string_view>{"cat"sv, "in"sv, "the"sv, "city"sv}), "Spaces should only separate words"s);
+    ASSERT_HINT(words.front().data() == text.data() + 2, "Words should point into the source text instead of being copied"s);
+    ASSERT_HINT(SplitIntoWords("   "sv).empty(), "Text of spaces should have no words"s);
+}
+
+// тест параллельного поиска: результат должен совпадать с последовательным
+void Tests::TestParallelFindTopDocuments()
+{
+    SearchServer server("and with"s);
+    const std::vector<std::string> words {"white"s, "cat"s, "fancy"s, "collar"s, "dog"s, "curly"s, "tail"s, "big"s};
+    // документов больше, чем PARALLEL_CHUNK_SIZE, чтобы списки резались на несколько задач
+    for (int document_id = 0; document_id < 10000; ++document_id)
+    {
+        const std::string content = words[document_id % words.size()] + " and "s + words[document_id * 7 % words.size()]
+                                    + " with "s + words[document_id * 3 % 5];
+        server.AddDocument(document_id, content, static_cast<DocumentStatus>(document_id % 4), {document_id % 11, document_id % 3});
+    }
+    const auto assert_same_documents = [](const std::vector<Document> &lhs, const std::vector<Document> &rhs)
+    {
+        ASSERT_EQUAL_HINT(lhs.size(), rhs.size(), "Parallel and sequential search should find the same number of documents"s);
+        for (std::size_t i = 0; i < lhs.size(); ++i)
+        {
+            ASSERT_HINT(std::abs(lhs[i].relevance - rhs[i].relevance) < MAX_RELEVANCE_DIFFERENCE, "Relevances should match"s);
+            ASSERT_EQUAL_HINT(lhs[i].rating, rhs[i].rating, "Ratings should match"s);
+        }
+    };
+    for (const std::string &query : {"curly cat"s, "white dog -tail"s, "big fancy collar -cat"s, "unknown"s})
+    {
+        assert_same_documents(server.FindTopDocuments(std::execution::par, query), server.FindTopDocuments(query));
+        assert_same_documents(server.FindTopDocuments(std::execution::seq, query), server.FindTopDocuments(query));
+        assert_same_documents(server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED),
+                              server.FindTopDocuments(query, DocumentStatus::BANNED));
+        const auto even_id = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+        assert_same_documents(server.FindTopDocuments(std::execution::par, query, even_id), server.FindTopDocuments(query, even_id));
+    }
+}
+
+// тест словаря с корзинами: параллельные добавления не теряются, Erase удаляет ключ
+void Tests::TestConcurrentMap()
+{
+    ConcurrentMap<int, int> counters(7);
+    std::vector<int> keys(1000);
+    std::iota(keys.begin(), keys.end(), -500);
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+        std::for_each(std::execution::par, keys.begin(), keys.end(), [&counters](int key) { ++counters[key].ref_to_value; });
+    }
+    counters.Erase(0);
+    const std::map<int, int> result = counters.BuildOrdinaryMap();
+    ASSERT_EQUAL_HINT(result.size(), 999u, "Every key except the erased one should be present"s);
+    ASSERT_HINT(std::all_of(result.begin(), result.end(), [](const auto &key_value) { return key_value.second == 3; }),
+                "No increment should be lost"s);
+    ASSERT_EQUAL_HINT(result.begin()->first, -500, "Negative keys should be supported"s);
+}
+
+// тест количества документов в выдаче: лучшие k документов в том же порядке, что и при полной сортировке
+void Tests::TestMaxResultCount()
+{
+    SearchServer server(""s);
+    for (int document_id = 0; document_id < 20; ++document_id)
+    {
+        // у части документов одинаковая релевантность, их порядок решает рейтинг
+        server.AddDocument(document_id, "cat"s + std::string(document_id % 4, 'x') + " dog"s, DocumentStatus::ACTUAL, {document_id});
+    }
+    const std::vector<Document> all_documents = server.FindTopDocuments("cat dog catx catxx"s, DocumentStatus::ACTUAL, 100);
+    ASSERT_EQUAL_HINT(all_documents.size(), 20u, "Big enough count should return every matched document"s);
+    ASSERT_HINT(std::is_sorted(all_documents.begin(), all_documents.end(), SearchServer::IsMoreRelevant), "Documents should be sorted"s);
+
+    const std::vector<Document> top_three = server.FindTopDocuments("cat dog catx catxx"s, [](int, DocumentStatus, int) { return true; }, 3);
+    ASSERT_EQUAL_HINT(top_three.size(), 3u, "We should get as many documents as we asked for"s);
+    for (std::size_t i = 0; i < top_three.size(); ++i)
+    {
+        ASSERT_EQUAL_HINT(top_three[i].id, all_documents[i].id, "Top documents should be the head of the full result"s);
+    }
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("cat dog"s).size(), static_cast<std::size_t>(MAX_RESULT_DOCUMENT_COUNT), "Default count should be used"s);
+    ASSERT_HINT(server.FindTopDocuments(std::execution::par, "cat dog"s, DocumentStatus::ACTUAL, 0).empty(), "Zero count should return nothing"s);
+    try
+    {
+        server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, -1);
+        ASSERT_HINT(false, "Negative count should throw"s);
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+}
+
+// тест пакетной обработки запросов: выдачи совпадают с FindTopDocuments, плоский обход идёт по порядку запросов
+void Tests::TestProcessQueries()
+{
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    server.AddDocument(4, "big dog cat Vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2});
+    const std::vector<std::string> queries {"nasty rat -not"s, "not very funny nasty pet"s, "unknown"s, "curly hair"s};
+
+    const std::vector<std::vector<Document>> results = ProcessQueries(server, queries);
+    ASSERT_EQUAL_HINT(results.size(), queries.size(), "There should be one result per query"s);
+    std::vector<int> expected_ids;
+    for (std::size_t i = 0; i < queries.size(); ++i)
+    {
+        const std::vector<Document> expected = server.FindTopDocuments(queries[i]);
+        ASSERT_EQUAL_HINT(results[i].size(), expected.size(), "Batch result should match a single query"s);
+        for (std::size_t j = 0; j < expected.size(); ++j)
+        {
+            ASSERT_EQUAL_HINT(results[i][j].id, expected[j].id, "Batch result should match a single query"s);
+            expected_ids.push_back(expected[j].id);
+        }
+    }
+
+    const JoinedDocuments joined = ProcessQueriesJoined(server, queries);
+    std::vector<int> joined_ids;
+    for (const Document &document : joined)
+    {
+        joined_ids.push_back(document.id);
+    }
+    ASSERT_EQUAL_HINT(joined_ids, expected_ids, "Joined results should go query by query"s);
+    ASSERT_EQUAL_HINT(joined.size(), expected_ids.size(), "Joined size should count every document"s);
+}
+
+// тест параллельного и пакетного удаления документов
+void Tests::TestRemoveDocuments()
+{
+    const auto make_server = []
+    {
+        SearchServer server("and"s);
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+        server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::BANNED, {1, 2, 8});
+        server.AddDocument(4, "big dog cat Vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2});
+        return server;
+    };
+    const auto found_ids = [](const SearchServer &server, const std::string &query)
+    {
+        std::set<int> ids;
+        for (const Document &document : server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; }, 10))
+        {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+    {
+        SearchServer server = make_server();
+        server.RemoveDocument(std::execution::par, 3);
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 3, "Parallel removal should remove the document"s);
+        ASSERT_EQUAL_HINT(found_ids(server, "nasty hair cat"s), (std::set<int>{1, 2, 4}), "Removed document should not be found"s);
+    }
+    {
+        SearchServer server = make_server();
+        server.RemoveDocuments({4, 1, 4});
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 2, "Bulk removal should remove every listed document once"s);
+        ASSERT_EQUAL_HINT(found_ids(server, "funny cat big"s), (std::set<int>{2, 3}), "Removed documents should not be found"s);
+        ASSERT_HINT(server.GetWordFrequencies(1).empty(), "Removed document should have no words"s);
+    }
+    {
+        SearchServer server = make_server();
+        try
+        {
+            server.RemoveDocuments({2, 42});
+            ASSERT_HINT(false, "Removing unknown id should throw"s);
+        }
+        catch (const std::out_of_range &)
+        {
+        }
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), 4, "Failed bulk removal should not remove anything"s);
+        ASSERT_EQUAL_HINT(found_ids(server, "curly"s), (std::set<int>{2}), "Failed bulk removal should not touch the index"s);
+    }
+}
+
+// тест пакетного добавления: индекс тот же, что после AddDocument по одному, ошибочные документы пропускаются
+void Tests::TestAddDocuments()
+{
+    const std::vector<std::string> words {"white"s, "cat"s, "fancy"s, "collar"s, "dog"s, "curly"s, "tail"s, "big"s};
+    std::vector<std::string> texts;
+    for (int i = 0; i < 1000; ++i)
+    {
+        texts.push_back(words[i % words.size()] + " and "s + words[i * 7 % words.size()] + " "s + words[i * 3 % 5]);
+    }
+    std::vector<DocumentToAdd> batch;
+    SearchServer expected_server("and"s);
+    for (int i = 0; i < static_cast<int>(texts.size()); ++i)
+    {
+        batch.push_back({i, texts[i], static_cast<DocumentStatus>(i % 4), {i % 11, i % 3}});
+        expected_server.AddDocument(i, texts[i], static_cast<DocumentStatus>(i % 4), {i % 11, i % 3});
+    }
+    const std::string bad_text = "cat \x12 dog"s;
+    batch.push_back({-1, "cat"sv, DocumentStatus::ACTUAL, {1}});
+    batch.push_back({5, "dog"sv, DocumentStatus::ACTUAL, {1}});
+    batch.push_back({2000, bad_text, DocumentStatus::ACTUAL, {1}});
+
+    SearchServer server("and"s);
+    server.AddDocument(5, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    const std::vector<AddDocumentError> errors = server.AddDocuments(batch);
+    expected_server.RemoveDocument(5);
+    expected_server.AddDocument(5, "cat dog"s, DocumentStatus::ACTUAL, {1});
+
+    std::set<int> error_ids;
+    for (const AddDocumentError &error : errors)
+    {
+        error_ids.insert(error.document_id);
+    }
+    ASSERT_EQUAL_HINT(error_ids, (std::set<int>{-1, 5, 2000}), "Only documents with bad ids or words should be reported"s);
+    ASSERT_EQUAL_HINT(errors.size(), 4u, "Occupied id 5 is reported for both documents with it"s);
+    ASSERT_EQUAL_HINT(server.GetDocumentCount(), expected_server.GetDocumentCount(), "All good documents should be added"s);
+    for (const int document_id : expected_server)
+    {
+        const auto expected_frequencies = expected_server.GetWordFrequencies(document_id);
+        const auto frequencies = server.GetWordFrequencies(document_id);
+        ASSERT_EQUAL_HINT(frequencies.size(), expected_frequencies.size(), "Word frequencies should match"s);
+        for (const auto &[word, freq] : expected_frequencies)
+        {
+            ASSERT_HINT(std::abs(frequencies.at(word) - freq) < MAX_WORD_FREQ_DIFFERENCE, "Word frequencies should match"s);
+        }
+    }
+    for (const std::string &query : {"curly cat"s, "white dog -tail"s})
+    {
+        const auto result = server.FindTopDocuments(query, DocumentStatus::BANNED);
+        const auto expected_result = expected_server.FindTopDocuments(query, DocumentStatus::BANNED);
+        ASSERT_EQUAL_HINT(result.size(), expected_result.size(), "Search results should match"s);
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(result[i].id, expected_result[i].id, "Search results should match"s);
+        }
+    }
+}
+
+// тест сохранённого IDF: после любых добавлений и удалений он равен log(N / df)
+void Tests::TestCachedIDF()
+{
+    SearchServer server(""s);
+    const auto assert_idf = [&server](const std::string &word, int document_frequency)
+    {
+        const double expected_IDF = std::log(static_cast<double>(server.GetDocumentCount()) / document_frequency);
+        ASSERT_HINT(std::abs(server.CalculateIDF(server.terms_.Find(word)) - expected_IDF) < MAX_RELEVANCE_DIFFERENCE,
+                    "Cached IDF should match log(N / df) for "s + word);
+    };
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "orange cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "dog in the park"s, DocumentStatus::ACTUAL, {1});
+    assert_idf("cat"s, 2);
+    assert_idf("park"s, 1);
+    server.RemoveDocument(2);
+    assert_idf("cat"s, 1);
+    assert_idf("in"s, 2);
+    server.AddDocuments({{4, "cat park"sv, DocumentStatus::ACTUAL, {1}}, {5, "big park"sv, DocumentStatus::ACTUAL, {1}}});
+    assert_idf("cat"s, 2);
+    assert_idf("park"s, 3);
+    server.RemoveDocuments({1, 3});
+    assert_idf("park"s, 2);
+    ASSERT_EQUAL_HINT(server.CalculateIDF(server.terms_.Find("city"s)), 0.0, "Word without documents should have zero IDF"s);
+}
+
+// тест внутренних номеров: разреженные внешние id, данные документов берутся из столбцов по номеру
+void Tests::TestDenseDocumentIndex()
+{
+    SearchServer server(""s);
+    server.AddDocument(1'000'000'000, "cat in the city"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(7, "orange cat"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(500'000, "dog in the park"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL_HINT(server.document_ids_.size(), 3u, "Internal ids should be dense regardless of external ids"s);
+    ASSERT_EQUAL_HINT(server.document_to_internal_id_.at(7), 1, "Internal ids should be assigned in insertion order"s);
+
+    const auto result = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(result.size(), 1u);
+    ASSERT_EQUAL_HINT(result[0].id, 1'000'000'000, "Search result should carry the external id"s);
+    ASSERT_EQUAL_HINT(result[0].rating, 5, "Search result should carry the rating from the columns"s);
+    ASSERT_EQUAL_HINT(std::get<1>(server.MatchDocument("cat"s, 7)), DocumentStatus::BANNED, "Status should be taken by internal id"s);
+
+    server.RemoveDocuments({7, 1'000'000'000});
+    server.AddDocument(3, "cat"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL_HINT(server.document_to_internal_id_.at(3), 3, "Internal ids of removed documents should not be reused"s);
+    const auto result_after_removal = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(result_after_removal.size(), 1u);
+    ASSERT_EQUAL(result_after_removal[0].id, 3);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT_HINT(server.GetWordFrequencies(7).empty(), "Removed document should have no words"s);
+}
+
+// тест накопителя релевантности: оба режима дают одно и то же, повторное использование не тащит старые данные
+void Tests::TestScoreAccumulator()
+{
+    ScoreAccumulator accumulator;
+    for (const int candidate_estimate : {1000, 1})
+    {
+        accumulator.Reset(1000, candidate_estimate);
+        ASSERT_EQUAL_HINT(accumulator.IsDense(), candidate_estimate == 1000, "Mode should depend on the candidate estimate"s);
+        accumulator.Add(700, 0.5);
+        accumulator.Add(3, 0.25);
+        accumulator.Add(700, 0.125);
+        accumulator.Add(42, 0.0);
+        accumulator.Add(500, 1.0);
+        accumulator.Erase(500);
+        accumulator.Erase(999);
+
+        std::vector<int> ids;
+        std::vector<double> scores;
+        accumulator.Collect([&](int document_id, double score)
+        {
+            ids.push_back(document_id);
+            scores.push_back(score);
+        });
+        ASSERT_EQUAL_HINT(ids, (std::vector<int>{3, 42, 700}), "Candidates should be collected by id, erased ones skipped"s);
+        ASSERT_HINT(std::abs(scores[2] - 0.625) < MAX_RELEVANCE_DIFFERENCE, "Scores should be summed"s);
+    }
+
+    accumulator.Reset(1000, 1000);
+    accumulator.Reset(1000, 1000);
+    accumulator.Add(700, 1.0);
+    accumulator.Add(500, 1.0);
+    double score_of_700 = 0;
+    int count = 0;
+    accumulator.Collect([&](int document_id, double score)
+    {
+        ++count;
+        if (document_id == 700) score_of_700 = score;
+    });
+    ASSERT_EQUAL_HINT(count, 2, "Reset should forget erased and touched documents"s);
+    ASSERT_HINT(std::abs(score_of_700 - 1.0) < MAX_RELEVANCE_DIFFERENCE, "Reset should zero touched scores"s);
+}
+
+// тест исключения документов с минус-словами: обе стратегии исключают одно и то же
+void Tests::TestExcludedDocuments()
+{
+    PostingList first_minus_word;
+    PostingList second_minus_word;
+    for (const int document_id : {3, 64, 65, 200})
+    {
+        first_minus_word.Add(document_id, 1);
+    }
+    second_minus_word.Add(64, 1);
+    second_minus_word.Add(130, 1);
+    second_minus_word.Remove(130);
+    const std::vector<const PostingList *> minus_postings {&first_minus_word, &second_minus_word};
+
+    ExcludedDocuments excluded_documents;
+    for (const auto &[plus_entry_count, strategy] : {std::pair{1'000'000, ExcludedDocuments::Strategy::SORTED_LIST},
+                                                     std::pair{10, ExcludedDocuments::Strategy::BITMAP}})
+    {
+        excluded_documents.Build(minus_postings, 256, plus_entry_count);
+        ASSERT_HINT(excluded_documents.GetStrategy() == strategy, "Strategy should depend on posting list lengths"s);
+        std::vector<int> excluded_ids;
+        ExcludedDocuments::Cursor cursor = excluded_documents.MakeCursor();
+        for (int document_id = 0; document_id < 256; ++document_id)
+        {
+            if (cursor.IsExcluded(document_id))
+            {
+                excluded_ids.push_back(document_id);
+            }
+        }
+        ASSERT_EQUAL_HINT(excluded_ids, (std::vector<int>{3, 64, 65, 200}), "Only live documents of minus words should be excluded"s);
+    }
+
+    PostingList removed_only;
+    removed_only.Add(130, 1);
+    removed_only.Remove(130);
+    excluded_documents.Build({&removed_only}, 256, 10);
+    ASSERT_HINT(excluded_documents.GetStrategy() == ExcludedDocuments::Strategy::NONE, "Nothing to exclude without live documents"s);
+    excluded_documents.Build({&first_minus_word}, 256, 10);
+    excluded_documents.Build({&second_minus_word}, 256, 10);
+    ASSERT_HINT(!excluded_documents.MakeCursor().IsExcluded(200), "Rebuild should forget previous documents"s);
+}
+
+// тест файла индекса: открытый сервер отвечает так же, как сохранённый, читает массивы прямо из файла
+// и после изменений ведёт себя так же, как исходный
+void Tests::TestSaveAndOpenIndex()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test_index.bin").string();
+    SearchServer server("and with"s);
+    for (int i = 0; i < 300; ++i)
+    {
+        const std::string text = (i % 2 ? "white cat"s : "black dog"s) + (i % 3 ? " fancy collar"s : " and tail"s)
+                               + (i % 7 ? ""s : " curly"s);
+        server.AddDocument(i * 3, text, static_cast<DocumentStatus>(i % 4), {i % 10, 3});
+    }
+    server.RemoveDocument(3);
+    server.SaveIndex(path);
+
+    SearchServer opened = SearchServer::OpenIndex(path);
+    ASSERT_HINT(opened.document_ids_.IsView() && opened.forward_term_ids_.IsView(), "Opened index should not copy the arrays"s);
+    const auto assert_same = [](const SearchServer &expected_server, const SearchServer &actual_server, const std::string &hint)
+    {
+        ASSERT_EQUAL_HINT(actual_server.GetDocumentCount(), expected_server.GetDocumentCount(), hint);
+        for (const std::string &query : {"curly cat"s, "collar -dog"s, "tail and"s, "unknown"s})
+        {
+            const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 1000);
+            const auto actual = actual_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 1000);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint);
+            for (std::size_t i = 0; i < actual.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, hint);
+                ASSERT_HINT(std::abs(actual[i].relevance - expected[i].relevance) < MAX_RELEVANCE_DIFFERENCE, hint);
+            }
+        }
+        for (const int document_id : expected_server)
+        {
+            ASSERT_EQUAL_HINT(std::get<0>(actual_server.MatchDocument("curly cat collar"s, document_id)),
+                              std::get<0>(expected_server.MatchDocument("curly cat collar"s, document_id)), hint);
+            ASSERT_EQUAL_HINT(actual_server.GetWordFrequencies(document_id).size(),
+                              expected_server.GetWordFrequencies(document_id).size(), hint);
+        }
+    };
+    assert_same(server, opened, "Opened index should answer like the saved one"s);
+    ASSERT_HINT(opened.FindTopDocuments("and"s).empty(), "Stop words should be saved"s);
+
+    for (SearchServer *target : {&server, &opened})
+    {
+        target->AddDocument(10'000, "curly white cat"s, DocumentStatus::IRRELEVANT, {5});
+        target->RemoveDocuments({6, 9, 12});
+    }
+    assert_same(server, opened, "Opened index should be editable"s);
+
+    // сохранение в тот же файл, из которого сервер открыт: его отображение не должно пострадать
+    opened.SaveIndex(path);
+    assert_same(server, opened, "Saving over the opened file should not break the opened server"s);
+    assert_same(server, SearchServer::OpenIndex(path), "Index saved over the opened file should open"s);
+
+    // файл кончается номерами живых документов: номер за пределами столбцов должен отвергаться, а не читаться
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-static_cast<std::streamoff>(sizeof(int)), std::ios::end);
+        const int broken_internal_id = 1'000'000;
+        file.write(reinterpret_cast<const char *>(&broken_internal_id), sizeof(broken_internal_id));
+    }
+    bool is_broken_thrown = false;
+    try
+    {
+        SearchServer::OpenIndex(path);
+    }
+    catch (const std::runtime_error &)
+    {
+        is_broken_thrown = true;
+    }
+    ASSERT_HINT(is_broken_thrown, "Opening an index with out-of-range document numbers should throw"s);
+    std::filesystem::remove(path);
+
+    bool is_thrown = false;
+    try
+    {
+        SearchServer::OpenIndex(path);
+    }
+    catch (const std::runtime_error &)
+    {
+        is_thrown = true;
+    }
+    ASSERT_HINT(is_thrown, "Opening a missing index should throw"s);
+}
+
+// тест журнала: изменения переживают пересоздание сервера, недописанный хвост журнала отбрасывается,
+// снимок очищает журнал
+void Tests::TestWriteAheadLog()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "search_server_test_wal";
+    std::filesystem::remove_all(directory);
+    const auto ids_of = [](const SearchServer &server)
+    {
+        return std::vector<int>(server.begin(), server.end());
+    };
+    std::vector<int> expected_ids;
+    {
+        DurableSearchServer server(directory.string(), "and with"sv);
+        server.AddDocument(1, "white cat and collar"sv, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocuments({{2, "black dog"sv, DocumentStatus::BANNED, {3}}, {1, "duplicate id"sv, DocumentStatus::ACTUAL, {}},
+                             {3, "curly dog"sv, DocumentStatus::ACTUAL, {4}}});
+        server.RemoveDocument(2);
+        bool is_thrown = false;
+        try
+        {
+            server.RemoveDocument(100);
+        }
+        catch (const std::out_of_range &)
+        {
+            is_thrown = true;
+        }
+        ASSERT(is_thrown);
+        expected_ids = ids_of(server.GetSearchServer());
+    }
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Log should restore all mutations"s);
+        ASSERT_EQUAL(server.GetSearchServer().FindTopDocuments("and"sv).size(), 0u);
+        ASSERT_EQUAL(server.GetSearchServer().FindTopDocuments("dog"sv)[0].id, 3);
+        server.AddDocument(4, "fancy cat"sv, DocumentStatus::ACTUAL, {});
+        expected_ids.push_back(4);
+    }
+
+    // обрыв посреди последней записи: её писатель не дождался подтверждения, документ должен пропасть
+    const std::filesystem::path log_path = directory / "wal.log";
+    const auto log_size = std::filesystem::file_size(log_path);
+    std::filesystem::resize_file(log_path, log_size - 3);
+    expected_ids.pop_back();
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Torn record should be dropped"s);
+        server.AddDocument(5, "white fancy dog"sv, DocumentStatus::ACTUAL, {7});
+        expected_ids.push_back(5);
+        server.Snapshot();
+        ASSERT_EQUAL_HINT(std::filesystem::file_size(log_path), 0u, "Snapshot should truncate the log"s);
+        server.RemoveDocument(1);
+        expected_ids.erase(expected_ids.begin());
+    }
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Log should be replayed over the snapshot"s);
+        ASSERT_EQUAL(server.GetSearchServer().FindTopDocuments("fancy"sv)[0].id, 5);
+        server.Snapshot();
+    }
+    int snapshot_count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        snapshot_count += entry.path().extension() == ".idx";
+    }
+    ASSERT_EQUAL_HINT(snapshot_count, 1, "Old snapshots should be removed"s);
+
+    // писатели из нескольких потоков: изменения применяются в порядке журнала и переживают пересоздание
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        const int before = server.GetSearchServer().GetDocumentCount();
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < 4; ++thread)
+        {
+            writers.emplace_back([&server, thread]
+                                 {
+                                     for (int i = 0; i < 25; ++i)
+                                     {
+                                         const int document_id = 1000 + thread * 100 + i;
+                                         server.AddDocument(document_id, "threaded cat"sv, DocumentStatus::ACTUAL, {1});
+                                         if (i % 5 == 0)
+                                         {
+                                             server.RemoveDocument(document_id);
+                                         }
+                                     }
+                                 });
+        }
+        for (std::thread &writer : writers)
+        {
+            writer.join();
+        }
+        ASSERT_EQUAL(server.GetSearchServer().GetDocumentCount(), before + 80);
+        bool is_thrown = false;
+        try
+        {
+            server.AddDocument(1001, "duplicate"sv, DocumentStatus::ACTUAL, {1});
+        }
+        catch (const std::invalid_argument &)
+        {
+            is_thrown = true;
+        }
+        ASSERT_HINT(is_thrown, "Occupied id should be rejected before logging"s);
+        expected_ids = ids_of(server.GetSearchServer());
+    }
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Concurrent writes should be replayed"s);
+
+        // неудачный fsync: изменение не применяется, а снимок отказывается записывать сломанный журнал
+        server.log_ = std::make_unique<WriteAheadLog>("/dev/full"s, server.log_->GetLastSequenceNumber() + 1);
+        bool is_add_thrown = false;
+        try
+        {
+            server.AddDocument(2000, "lost cat"sv, DocumentStatus::ACTUAL, {1});
+        }
+        catch (const std::runtime_error &)
+        {
+            is_add_thrown = true;
+        }
+        ASSERT(is_add_thrown);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Failed write should not reach the server"s);
+        bool is_snapshot_thrown = false;
+        try
+        {
+            server.Snapshot();
+        }
+        catch (const std::runtime_error &)
+        {
+            is_snapshot_thrown = true;
+        }
+        ASSERT_HINT(is_snapshot_thrown, "Snapshot should refuse a broken log"s);
+    }
+    {
+        DurableSearchServer server(directory.string(), ""sv);
+        ASSERT_EQUAL_HINT(ids_of(server.GetSearchServer()), expected_ids, "Failed write should not come back after restart"s);
+    }
+
+    // испорченная контрольная сумма обрывает журнал так же, как недописанная запись
+    const std::string path = (directory / "checksum.log").string();
+    {
+        WriteAheadLog log(path, 1);
+        log.Append("first"sv);
+        log.WaitDurable(log.Append("second"sv));
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    {
+        std::FILE *file = std::fopen(path.c_str(), "ab");
+        std::fputc('x', file);
+        std::fclose(file);
+    }
+    std::vector<std::string> payloads;
+    const std::uint64_t last = WriteAheadLog::Replay(path, [&payloads](std::uint64_t, std::string_view payload)
+                                                     { payloads.emplace_back(payload); });
+    ASSERT_EQUAL(last, 1u);
+    ASSERT_EQUAL(payloads, std::vector<std::string>{"first"s});
+
+    // журнал длиннее одного куска чтения (64 КиБ): записи за границей куска читаются и не отрезаются
+    const std::string long_path = (directory / "long.log").string();
+    std::vector<std::string> long_payloads;
+    {
+        WriteAheadLog log(long_path, 1);
+        for (char letter : {'a', 'b', 'c'})
+        {
+            long_payloads.emplace_back(40'000, letter);
+            log.Append(long_payloads.back());
+        }
+        log.Flush();
+    }
+    const auto long_size = std::filesystem::file_size(long_path);
+    payloads.clear();
+    ASSERT_EQUAL(WriteAheadLog::Replay(long_path, [&payloads](std::uint64_t, std::string_view payload)
+                                       { payloads.emplace_back(payload); }),
+                 3u);
+    ASSERT_EQUAL_HINT(payloads, long_payloads, "Records after the first read chunk should be replayed"s);
+    ASSERT_EQUAL_HINT(std::filesystem::file_size(long_path), long_size, "Whole log should not be cut"s);
+    std::filesystem::remove_all(directory);
+
+    // неудачная запись ломает журнал: ни одна запись потерянной группы и ни одна последующая не подтверждается
+    {
+        const auto throws = [](const auto &func)
+        {
+            try
+            {
+                func();
+            }
+            catch (const std::runtime_error &)
+            {
+                return true;
+            }
+            return false;
+        };
+        // любая запись в /dev/full заканчивается ENOSPC
+        WriteAheadLog log("/dev/full"s, 1);
+        const std::uint64_t first = log.Append("first"sv);
+        const std::uint64_t second = log.Append("second"sv);
+        ASSERT_HINT(throws([&log, second]
+                           { log.WaitDurable(second); }),
+                    "Failed write should be reported"s);
+        ASSERT_HINT(throws([&log, first]
+                           { log.WaitDurable(first); }),
+                    "Records of the lost group should never be acknowledged"s);
+        ASSERT_HINT(throws([&log]
+                           { log.Append("third"sv); }),
+                    "Broken log should refuse new records"s);
+        ASSERT(throws([&log]
+                      { log.Flush(); }));
+    }
+}
+
+// тест кэша ответов: одинаковые после нормализации запросы попадают в одну запись, изменение сервера
+// сбрасывает кэш, записи вытесняются по бюджету памяти
+void Tests::TestQueryResultCache()
+{
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat and collar"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog"sv, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "curly cat"sv, DocumentStatus::BANNED, {3});
+
+    QueryResultCache cache(server, 1 << 20);
+    ASSERT_EQUAL(cache.FindTopDocuments("cat dog"sv).size(), 2u);
+    ASSERT_EQUAL(cache.GetMissCount(), 1u);
+    for (const std::string_view query : {"dog cat"sv, "cat and dog dog"sv, "cat dog -unknown"sv})
+    {
+        ASSERT_EQUAL_HINT(cache.FindTopDocuments(query).size(), 2u, "Cached answer should be returned"s);
+    }
+    ASSERT_EQUAL_HINT(cache.GetHitCount(), 3u, "Normalized queries should share an entry"s);
+    ASSERT_EQUAL(cache.GetMissCount(), 1u);
+
+    ASSERT_EQUAL(cache.FindTopDocuments("cat dog"sv, DocumentStatus::BANNED)[0].id, 3);
+    ASSERT_EQUAL(cache.FindTopDocuments("cat dog"sv, DocumentStatus::ACTUAL, 1).size(), 1u);
+    ASSERT_EQUAL(cache.FindTopDocuments("cat -dog"sv).size(), 1u);
+    const auto even = [](int document_id, DocumentStatus, int)
+    { return document_id % 2 == 0; };
+    ASSERT_EQUAL(cache.FindTopDocuments("cat dog"sv, "even"sv, even)[0].id, 2);
+    ASSERT_EQUAL(cache.FindTopDocuments("dog cat"sv, "even"sv, even).size(), 1u);
+    ASSERT_EQUAL_HINT(cache.GetMissCount(), 5u, "Status, count, minus words and filter should be part of the key"s);
+    ASSERT_EQUAL(cache.GetHitCount(), 4u);
+
+    server.AddDocument(4, "fancy dog"sv, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL_HINT(cache.FindTopDocuments("cat dog"sv).size(), 3u, "Adding a document should invalidate the cache"s);
+    server.RemoveDocument(4);
+    ASSERT_EQUAL_HINT(cache.FindTopDocuments("cat dog"sv).size(), 2u, "Removing a document should invalidate the cache"s);
+    ASSERT_EQUAL(cache.GetMissCount(), 7u);
+
+    bool is_thrown = false;
+    try
+    {
+        cache.FindTopDocuments("cat --dog"sv);
+    }
+    catch (const std::invalid_argument &)
+    {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+
+    QueryResultCache small_cache(server, 0);
+    small_cache.FindTopDocuments("cat"sv);
+    small_cache.FindTopDocuments("cat"sv);
+    ASSERT_EQUAL_HINT(small_cache.GetHitCount(), 0u, "Entry larger than the budget should not be stored"s);
+    ASSERT_EQUAL(small_cache.GetMemoryUsage(), 0u);
+
+    // у "white" и "black" по одному слову и одному документу, записи одного размера
+    QueryResultCache measuring_cache(server, 1 << 20);
+    measuring_cache.FindTopDocuments("white"sv);
+    QueryResultCache one_entry_cache(server, measuring_cache.GetMemoryUsage() + 1);
+    one_entry_cache.FindTopDocuments("white"sv);
+    ASSERT_EQUAL(one_entry_cache.GetMemoryUsage(), measuring_cache.GetMemoryUsage());
+    one_entry_cache.FindTopDocuments("black"sv);
+    one_entry_cache.FindTopDocuments("black"sv);
+    one_entry_cache.FindTopDocuments("white"sv);
+    ASSERT_EQUAL_HINT(one_entry_cache.GetHitCount(), 1u, "Old entry should be evicted when over budget"s);
+}
+
+// тест снимков: снимок не меняется после записи, обе версии сервера идут в ногу с обычным сервером,
+// читатели из других потоков видят только целые версии
+void Tests::TestSnapshotSearchServer()
+{
+    SearchServer expected("and with"s);
+    SnapshotSearchServer server(SearchServer("and with"s));
+    const auto assert_same = [&expected](const SearchServer &actual, const std::string &hint)
+    {
+        ASSERT_EQUAL_HINT(std::vector<int>(actual.begin(), actual.end()), std::vector<int>(expected.begin(), expected.end()), hint);
+        for (const std::string_view query : {"cat"sv, "dog -white"sv, "curly collar"sv})
+        {
+            const auto expected_documents = expected.FindTopDocuments(query);
+            const auto actual_documents = actual.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(actual_documents.size(), expected_documents.size(), hint);
+            for (std::size_t i = 0; i < actual_documents.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(actual_documents[i].id, expected_documents[i].id, hint);
+            }
+        }
+    };
+
+    const std::vector<std::string> texts = {"white cat and collar"s, "black dog"s, "curly cat"s, "white dog with collar"s};
+    for (int i = 0; i < 12; ++i)
+    {
+        expected.AddDocument(i, texts[i % texts.size()], DocumentStatus::ACTUAL, {i});
+        server.AddDocument(i, texts[i % texts.size()], DocumentStatus::ACTUAL, {i});
+        assert_same(*server.GetSnapshot(), "Snapshot should follow every write"s);
+    }
+    const std::vector<DocumentToAdd> batch = {{20, "curly dog"sv, DocumentStatus::ACTUAL, {1}}, {3, "duplicate"sv, DocumentStatus::ACTUAL, {}}};
+    ASSERT_EQUAL(server.AddDocuments(batch).size(), expected.AddDocuments(batch).size());
+    expected.RemoveDocuments({1, 2});
+    server.RemoveDocuments({1, 2});
+    bool is_thrown = false;
+    try
+    {
+        server.RemoveDocument(100);
+    }
+    catch (const std::out_of_range &)
+    {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+    expected.RemoveDocument(5);
+    server.RemoveDocument(5);
+    assert_same(*server.GetSnapshot(), "Failed write should not break the versions"s);
+    // запасная версия догоняет опубликованную при следующей записи
+    server.PrepareStandby();
+    assert_same(*server.standby_, "Standby version should replay the same writes"s);
+
+    // читатель держит снимок дольше, чем готов ждать писатель: запись идёт в копию
+    const std::shared_ptr<const SearchServer> old_snapshot = server.GetSnapshot();
+    const int old_count = old_snapshot->GetDocumentCount();
+    expected.AddDocument(30, "fancy cat"sv, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(30, "fancy cat"sv, DocumentStatus::ACTUAL, {5});
+    expected.AddDocument(31, "fancy dog"sv, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(31, "fancy dog"sv, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL_HINT(old_snapshot->GetDocumentCount(), old_count, "Held snapshot should not change"s);
+    assert_same(*server.GetSnapshot(), "Writes should go on while an old snapshot is held"s);
+
+    // все документы содержат "cat", поэтому в целой версии его находят во всех документах
+    SnapshotSearchServer concurrent_server(SearchServer(""s));
+    std::atomic<bool> is_writing = true;
+    std::atomic<bool> is_consistent = true;
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; ++reader)
+    {
+        readers.emplace_back([&]
+                             {
+                                 int last_count = 0;
+                                 while (is_writing)
+                                 {
+                                     const auto snapshot = concurrent_server.GetSnapshot();
+                                     const int count = snapshot->GetDocumentCount();
+                                     const auto documents = snapshot->FindTopDocuments("cat"sv, DocumentStatus::ACTUAL, 1'000'000);
+                                     if (count < last_count || static_cast<int>(documents.size()) != count)
+                                     {
+                                         is_consistent = false;
+                                     }
+                                     last_count = count;
+                                 }
+                             });
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        concurrent_server.AddDocument(i, "cat number"s + std::to_string(i), DocumentStatus::ACTUAL, {i});
+    }
+    is_writing = false;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    ASSERT_HINT(is_consistent, "Readers should see only complete versions"s);
+    ASSERT_EQUAL(concurrent_server.GetSnapshot()->GetDocumentCount(), 100);
+}
+
+// тест сегментов: после добавлений, удалений, заморозок и слияний ответы совпадают с одним SearchServer,
+// число сегментов держится политикой слияния
+void Tests::TestSegmentedSearchServer()
+{
+    SearchServer expected("and with"s);
+    SegmentedSearchServer server("and with"sv, 8);
+    const auto assert_same = [&expected, &server](const std::string &hint)
+    {
+        ASSERT_EQUAL_HINT(server.GetDocumentCount(), expected.GetDocumentCount(), hint);
+        for (const std::string_view query : {"cat"sv, "dog -white"sv, "curly collar fancy"sv, "tail -cat -dog"sv})
+        {
+            for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED})
+            {
+                const auto expected_documents = expected.FindTopDocuments(query, status, 1'000);
+                const auto actual_documents = server.FindTopDocuments(query, status, 1'000);
+                ASSERT_EQUAL_HINT(actual_documents.size(), expected_documents.size(), hint);
+                for (std::size_t i = 0; i < actual_documents.size(); ++i)
+                {
+                    ASSERT_EQUAL_HINT(actual_documents[i].id, expected_documents[i].id, hint);
+                    ASSERT_EQUAL_HINT(actual_documents[i].rating, expected_documents[i].rating, hint);
+                    ASSERT_HINT(std::abs(actual_documents[i].relevance - expected_documents[i].relevance) < MAX_RELEVANCE_DIFFERENCE, hint);
+                }
+            }
+        }
+    };
+    const std::vector<std::string> texts = {"white cat and collar"s, "black dog dog"s, "curly cat with tail"s, "fancy white dog"s, "tail"s};
+    const auto add = [&](int id)
+    {
+        const std::string &text = texts[id % texts.size()];
+        const DocumentStatus status = id % 3 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED;
+        expected.AddDocument(id, text, status, {id});
+        server.AddDocument(id, text, status, {id});
+    };
+    for (int id = 0; id < 100; ++id)
+    {
+        add(id);
+    }
+    assert_same("Frozen segments and buffer should answer like one server"s);
+    for (int id = 0; id < 100; id += 3)
+    {
+        expected.RemoveDocument(id);
+        server.RemoveDocument(id);
+    }
+    assert_same("Deleted documents should not count in scores or IDF"s);
+    // удалённый id можно занять снова, он попадёт в буфер
+    add(3);
+    bool is_thrown = false;
+    try
+    {
+        server.AddDocument(4, "duplicate"sv, DocumentStatus::ACTUAL, {});
+    }
+    catch (const std::invalid_argument &)
+    {
+        is_thrown = true;
+    }
+    ASSERT_HINT(is_thrown, "Id of a frozen document should stay occupied"s);
+    is_thrown = false;
+    try
+    {
+        server.RemoveDocument(6);
+    }
+    catch (const std::out_of_range &)
+    {
+        is_thrown = true;
+    }
+    ASSERT_HINT(is_thrown, "Removed document should not be removed again"s);
+
+    server.Flush();
+    server.WaitForMerges();
+    assert_same("Merges should keep the answers"s);
+    // 13 заморозок по 8 документов: на каждом уровне остаётся меньше MERGE_FACTOR сегментов
+    ASSERT_HINT(server.GetSegmentCount() < 2 * SegmentedSearchServer::MERGE_FACTOR, "Merge policy should bound segment count"s);
+
+    for (int id = 1; id < 100; ++id)
+    {
+        if (id % 3 != 0)
+        {
+            expected.RemoveDocument(id);
+            server.RemoveDocument(id);
+        }
+    }
+    server.WaitForMerges();
+    assert_same("Mostly deleted segments should be compacted"s);
+    // живым остался только заново добавленный документ 3
+    ASSERT_EQUAL_HINT(server.GetSegmentCount(), 1, "Fully deleted segments should be dropped"s);
+}
+
+// тест курсора списка документов: Next и Advance по блокам и хвосту, с удалёнными записями
+void Tests::TestPostingListCursor()
+{
+    PostingList postings;
+    std::vector<int> expected_ids;
+    for (int id = 0; id < 1000; id += 3)
+    {
+        postings.Add(id, id % 5 + 1);
+        expected_ids.push_back(id);
+    }
+    // удаляем меньше половины, чтобы список не пересобрался
+    std::vector<int> removed_ids;
+    for (int id = 0; id < 1000; id += 21)
+    {
+        removed_ids.push_back(id);
+    }
+    postings.Remove(removed_ids);
+    expected_ids.erase(std::remove_if(expected_ids.begin(), expected_ids.end(), [](int id)
+                                      { return id % 21 == 0; }),
+                       expected_ids.end());
+
+    std::vector<int> visited_ids;
+    for (PostingList::Cursor cursor(postings); !cursor.IsEnd(); cursor.Next())
+    {
+        ASSERT_EQUAL(cursor.GetTermCount(), cursor.GetDocumentId() % 5 + 1);
+        visited_ids.push_back(cursor.GetDocumentId());
+    }
+    ASSERT_EQUAL_HINT(visited_ids, expected_ids, "Cursor should visit live documents in order"s);
+
+    for (const int step : {1, 7, 50, 400})
+    {
+        PostingList::Cursor cursor(postings);
+        for (int target = 0; target < 1100; target += step)
+        {
+            cursor.Advance(target);
+            const auto expected = std::lower_bound(expected_ids.begin(), expected_ids.end(), target);
+            if (expected == expected_ids.end())
+            {
+                ASSERT_HINT(cursor.IsEnd(), "Cursor should end after the last document"s);
+                break;
+            }
+            ASSERT_EQUAL_HINT(cursor.GetDocumentId(), *expected, "Advance should stop at the first document not less than target"s);
+        }
+    }
+    PostingList empty;
+    ASSERT(PostingList::Cursor(empty).IsEnd());
+}
+
+// тест оценок блоков: TF любого живого документа не больше оценки его блока, в том числе после вставки
+// в середину списка и пересборки, а оценки считаются по блоку, а не по всему списку
+void Tests::TestPostingListBlockBounds()
+{
+    const auto term_frequency = [](int id)
+    { return (id % 97 + 1) / 100.0; };
+    PostingList postings;
+    for (int id = 0; id < 2000; id += 2)
+    {
+        postings.Add(id, 1, term_frequency(id));
+    }
+    // первые 128 документов - целый блок, их наибольший TF меньше, чем у всего списка
+    PostingList::Cursor first_block(postings);
+    ASSERT_EQUAL(first_block.GetBlockLastDocumentId(), 254);
+    ASSERT(first_block.GetBlockMaxTermFrequency() >= term_frequency(96));
+    ASSERT(first_block.GetBlockMaxTermFrequency() < term_frequency(96) + 1e-6);
+    ASSERT(postings.GetMaxTermFrequency() >= term_frequency(96));
+
+    const auto check_bounds = [&](const std::string &hint)
+    {
+        for (PostingList::Cursor cursor(postings); !cursor.IsEnd(); cursor.Next())
+        {
+            const int id = cursor.GetDocumentId();
+            ASSERT_HINT(cursor.GetBlockLastDocumentId() >= id, hint);
+            ASSERT_HINT(cursor.GetBlockMaxTermFrequency() >= term_frequency(id), hint);
+            ASSERT_HINT(postings.GetMaxTermFrequency() >= term_frequency(id), hint);
+            ASSERT_HINT(PostingList::Cursor(postings).GetMaxTermFrequencyAt(id) >= term_frequency(id), hint);
+        }
+    };
+    check_bounds("Block bounds after appending"s);
+
+    for (int id = 1; id < 2000; id += 50)
+    {
+        postings.Add(id, 1, term_frequency(id));
+    }
+    check_bounds("Block bounds after inserting in the middle"s);
+
+    std::vector<int> removed_ids;
+    for (int id = 0; id < 2000; ++id)
+    {
+        if (id % 3 != 0)
+        {
+            removed_ids.push_back(id);
+        }
+    }
+    postings.Remove(removed_ids);
+    check_bounds("Block bounds after compaction"s);
+    ASSERT(PostingList::Cursor(postings).GetMaxTermFrequencyAt(5000) == 0);
+}
+
+// тест поиска лучших с отсечением: на случайном корпусе ответ совпадает с полным перебором
+// при любом числе результатов, фильтре, минус-словах и удалениях
+void Tests::TestTopDocumentsPruning()
+{
+    std::mt19937 generator(7);
+    std::geometric_distribution<int> word_distribution(0.05);
+    SearchServer server("w0"s);
+    for (int id = 0; id < 3000; ++id)
+    {
+        std::string text;
+        const int word_count = 3 + id % 17;
+        for (int i = 0; i < word_count; ++i)
+        {
+            text += " w"s + std::to_string(word_distribution(generator) % 200);
+        }
+        // рейтинг уникален: при равной релевантности порядок задан однозначно
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id});
+    }
+    std::vector<int> removed_ids;
+    for (int id = 0; id < 3000; id += 7)
+    {
+        removed_ids.push_back(id);
+    }
+    server.RemoveDocuments(removed_ids);
+
+    const std::vector<std::string> queries = {"w1"s, "w1 w2 w3"s, "w5 w40 w3 w1 w2 w100 w7"s, "w1 w2 -w3"s, "w150 w1 -w4 -w5"s, "w199 w198"s, "-w1"s, "unknown"s};
+    const auto odd_rating = [](int, DocumentStatus, int rating)
+    { return rating % 2 == 1; };
+    const auto actual_status = [](int, DocumentStatus status, int)
+    { return status == DocumentStatus::ACTUAL; };
+    for (const std::string &raw_query : queries)
+    {
+        const SearchServer::ProcessedQuery query = server.ParseQuery(raw_query);
+        for (const int max_result_count : {0, 1, 5, 20, 10'000})
+        {
+            const auto check = [&](const auto &filter)
+            {
+                std::vector<Document> expected = server.FindAllDocuments(query, SearchServer::ALL_STATUSES, server.MakeDocumentPredicate(filter));
+                const auto expected_end = expected.begin() + std::min<std::size_t>(expected.size(), max_result_count);
+                std::partial_sort(expected.begin(), expected_end, expected.end(), SearchServer::IsMoreRelevant);
+                expected.erase(expected_end, expected.end());
+                const std::vector<Document> actual = server.FindTopDocumentsPruned(query, SearchServer::ALL_STATUSES, server.MakeDocumentPredicate(filter),
+                                                                                          max_result_count);
+                const std::string hint = "Pruned top-k should match exhaustive search for \""s + raw_query + "\""s;
+                ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint);
+                for (std::size_t i = 0; i < actual.size(); ++i)
+                {
+                    ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, hint);
+                    ASSERT_EQUAL_HINT(actual[i].rating, expected[i].rating, hint);
+                    ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, hint);
+                }
+            };
+            check(actual_status);
+            check(odd_rating);
+        }
+    }
+}
+
+// тест списков документов по статусам: документ лежит только в списках своего статуса, запрос по статусу
+// совпадает с фильтром по статусу, смена статуса, удаление и файл индекса сохраняют списки согласованными
+void Tests::TestStatusPartitions()
+{
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocuments({{4, "cat dog"sv, DocumentStatus::IRRELEVANT, {4}}, {5, "banned cat"sv, DocumentStatus::BANNED, {5}}});
+
+    const auto count_in = [](const SearchServer &search_server, DocumentStatus status, const std::string &word)
+    {
+        const PostingList *postings = search_server.word_to_document_frequency_[static_cast<int>(status)].Find(search_server.terms_.Find(word));
+        return postings != nullptr ? postings->GetDocumentCount() : 0;
+    };
+    ASSERT_EQUAL(count_in(server, DocumentStatus::ACTUAL, "cat"s), 1);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::BANNED, "cat"s), 2);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::IRRELEVANT, "cat"s), 1);
+    ASSERT_EQUAL_HINT(server.word_to_document_frequency_[static_cast<int>(DocumentStatus::REMOVED)].GetListCount(), 0u,
+                      "Lists of a status without documents should not be allocated"s);
+    // у IRRELEVANT только слова документа 4, хотя его слова получили id позже слов прочих документов
+    ASSERT_EQUAL_HINT(server.word_to_document_frequency_[static_cast<int>(DocumentStatus::IRRELEVANT)].GetListCount(), 2u,
+                      "Lists of a rare status should be allocated only for its words"s);
+
+    const auto check_matches_filter = [](const SearchServer &search_server, const std::string &hint)
+    {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED})
+        {
+            const auto has_status = [status](int, DocumentStatus document_status, int)
+            { return document_status == status; };
+            for (const std::string &query : {"cat"s, "cat dog"s, "cat -fluffy"s, "tail collar eyes"s})
+            {
+                const std::vector<Document> expected = search_server.FindTopDocuments(query, has_status);
+                for (const std::vector<Document> &actual : {search_server.FindTopDocuments(query, status),
+                                                            search_server.FindTopDocuments(std::execution::par, query, status)})
+                {
+                    ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint);
+                    for (std::size_t i = 0; i < actual.size(); ++i)
+                    {
+                        ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, hint);
+                        ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, hint);
+                    }
+                }
+            }
+        }
+    };
+    check_matches_filter(server, "Status query should match the status filter"s);
+
+    const std::uint64_t epoch = server.GetEpoch();
+    server.SetDocumentStatus(2, DocumentStatus::ACTUAL);
+    ASSERT_HINT(server.GetEpoch() != epoch, "Status change should invalidate cached answers"s);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::ACTUAL, "cat"s), 2);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::BANNED, "cat"s), 1);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::BANNED, "fluffy"s), 0);
+    ASSERT_EQUAL(std::get<1>(server.MatchDocument("cat"s, 2)), DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy"s).size(), 1u);
+    ASSERT(server.FindTopDocuments("fluffy"s, DocumentStatus::BANNED).empty());
+    check_matches_filter(server, "Status query should match the status filter after a status change"s);
+
+    server.RemoveDocument(5);
+    server.RemoveDocuments({4});
+    ASSERT_EQUAL(count_in(server, DocumentStatus::BANNED, "cat"s), 0);
+    ASSERT_EQUAL(count_in(server, DocumentStatus::IRRELEVANT, "dog"s), 0);
+    ASSERT_EQUAL(server.GetDocumentFrequency(server.terms_.Find("cat"s)), 2);
+    check_matches_filter(server, "Status query should match the status filter after removals"s);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test_status_index.bin").string();
+    server.SaveIndex(path);
+    {
+        const SearchServer opened = SearchServer::OpenIndex(path);
+        ASSERT_EQUAL(count_in(opened, DocumentStatus::ACTUAL, "cat"s), 2);
+        check_matches_filter(opened, "Status query should match the status filter in an opened index"s);
+    }
+    std::filesystem::remove(path);
+
+    try
+    {
+        server.SetDocumentStatus(100, DocumentStatus::BANNED);
+        ASSERT_HINT(false, "Status change of an unknown document should throw"s);
+    }
+    catch (const std::out_of_range &)
+    {
+    }
+}
+
+// тест декларативного фильтра: векторная проверка столбцов совпадает со скалярной и с проверкой
+// по одному документу, а поиск с фильтром - с поиском с такой же лямбдой, для широких и избирательных запросов
+void Tests::TestDocumentFilter()
+{
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<int> value_distribution(-50, 50);
+    // число документов не кратно 64: последнее слово карты заполняется скалярно
+    const int document_count = 1000;
+    std::vector<int> document_ids(document_count);
+    std::vector<int> ratings(document_count);
+    for (int i = 0; i < document_count; ++i)
+    {
+        document_ids[i] = value_distribution(generator);
+        ratings[i] = value_distribution(generator);
+    }
+    const std::vector<DocumentFilter> filters = {DocumentFilter(), DocumentFilter().SetRatingRange(0, 10), DocumentFilter().SetIdRange(-5, 5),
+                                                 DocumentFilter().SetRatingRange(-50, -50).SetIdRange(0, std::numeric_limits<int>::max()),
+                                                 DocumentFilter().SetRatingRange(std::numeric_limits<int>::min(), 0)};
+    for (const DocumentFilter &filter : filters)
+    {
+        std::vector<std::uint64_t> selection(DocumentFilter::GetSelectionWordCount(document_count));
+        std::vector<std::uint64_t> scalar_selection(selection.size());
+        filter.SelectInRanges(document_ids.data(), ratings.data(), document_count, selection.data());
+        filter.SelectInRangesScalar(document_ids.data(), ratings.data(), document_count, scalar_selection.data());
+        ASSERT_EQUAL_HINT(selection, scalar_selection, "Vectorized selection should match the scalar one"s);
+        for (int i = 0; i < document_count; ++i)
+        {
+            ASSERT_EQUAL_HINT(DocumentFilter::IsSelected(selection.data(), i), filter(document_ids[i], DocumentStatus::ACTUAL, ratings[i]),
+                              "Selection should match the per-document check"s);
+        }
+    }
+
+    SearchServer server(""s);
+    std::geometric_distribution<int> word_distribution(0.05);
+    for (int id = 0; id < 3000; ++id)
+    {
+        std::string text;
+        for (int i = 0; i < 10; ++i)
+        {
+            text += " w"s + std::to_string(word_distribution(generator) % 300);
+        }
+        // рейтинг уникален: при равной релевантности порядок задан однозначно
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id * 7919 % 3000});
+    }
+    const std::vector<DocumentFilter> server_filters = {DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED}),
+                                                        DocumentFilter().SetRatingRange(2700, 3000),
+                                                        DocumentFilter().SetStatuses({DocumentStatus::IRRELEVANT}).SetIdRange(100, 2000).SetRatingRange(0, 1500)};
+    // первые запросы широкие - отрезки проверяются по столбцам, последние избирательные - по кандидатам
+    for (const std::string &query : {"w0 w1 w2"s, "w3 -w4"s, "w60"s, "w70 w75 -w0"s})
+    {
+        for (const DocumentFilter &filter : server_filters)
+        {
+            const auto lambda = [&filter](int document_id, DocumentStatus status, int rating)
+            { return filter(document_id, status, rating); };
+            const std::vector<Document> expected = server.FindTopDocuments(query, lambda, 20);
+            for (const std::vector<Document> &actual : {server.FindTopDocuments(query, filter, 20), server.FindTopDocuments(std::execution::par, query, filter, 20)})
+            {
+                ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Declarative filter should match the same lambda for \""s + query + "\""s);
+                for (std::size_t i = 0; i < actual.size(); ++i)
+                {
+                    ASSERT_EQUAL(actual[i].id, expected[i].id);
+                    ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+                }
+            }
+        }
+    }
+
+    const auto assert_throws = [](const auto &make_filter, const std::string &hint)
+    {
+        try
+        {
+            make_filter();
+            ASSERT_HINT(false, hint);
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+    };
+    assert_throws([] { DocumentFilter().SetRatingRange(5, 4); }, "Empty rating range should throw"s);
+    assert_throws([] { DocumentFilter().SetIdRange(1, 0); }, "Empty id range should throw"s);
+    assert_throws([] { DocumentFilter().SetStatuses({}); }, "Empty status set should throw"s);
+}
+
+// тест индекса рейтингов: номера документов упорядочены внутри рейтинга, удаление и выборка по диапазону,
+// а поиск с фильтром по редким рейтингам через индекс совпадает с поиском с такой же лямбдой
+void Tests::TestRatingIndex()
+{
+    RatingIndex index;
+    for (int internal_id = 0; internal_id < 10; ++internal_id)
+    {
+        if (internal_id != 4)
+        {
+            index.Add(internal_id % 3, internal_id);
+        }
+    }
+    // номер меньше уже добавленных встаёт на своё место
+    index.Add(1, 4);
+    std::vector<int> internal_ids;
+    index.FindInRange(1, 2, internal_ids);
+    ASSERT_EQUAL(internal_ids, (std::vector<int>{1, 2, 4, 5, 7, 8}));
+    ASSERT_EQUAL(index.CountInRange(1, 2), 6);
+    index.Remove(2, std::vector<int>{2, 5, 6});
+    index.Remove(0, 3);
+    ASSERT_EQUAL(index.CountInRange(0, 0), 3);
+    index.FindInRange(std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), internal_ids);
+    ASSERT_EQUAL(internal_ids, (std::vector<int>{0, 1, 4, 6, 7, 8, 9}));
+    ASSERT_EQUAL(index.GetDocumentCount(), 7);
+    index.FindInRange(3, 100, internal_ids);
+    ASSERT_HINT(internal_ids.empty(), "No documents should have a rating out of the index"s);
+
+    // редкие высокие рейтинги у документов с частыми словами: поиск идёт по индексу рейтингов
+    SearchServer server(""s);
+    std::mt19937 generator(13);
+    std::geometric_distribution<int> word_distribution(0.1);
+    for (int id = 0; id < 4000; ++id)
+    {
+        std::string text;
+        for (int i = 0; i < 10; ++i)
+        {
+            text += " w"s + std::to_string(word_distribution(generator) % 100);
+        }
+        const int rating = id % 100 == 0 ? 1000 + id : id % 50;
+        server.AddDocument(id * 2, text, static_cast<DocumentStatus>(id % 3), {rating});
+    }
+    server.RemoveDocument(800);
+    server.RemoveDocuments({1600, 2400, 2402, 6});
+    server.SetDocumentStatus(3200, DocumentStatus::REMOVED);
+    const auto check = [](const SearchServer &server, const std::string &hint)
+    {
+        std::vector<int> expected_ids;
+        for (int internal_id = 0; internal_id < static_cast<int>(server.document_ratings_.size()); ++internal_id)
+        {
+            if (server.document_to_internal_id_.count(server.document_ids_[internal_id]) > 0 && server.document_ratings_[internal_id] >= 1000)
+            {
+                expected_ids.push_back(internal_id);
+            }
+        }
+        std::vector<int> actual_ids;
+        server.rating_index_.FindInRange(1000, std::numeric_limits<int>::max(), actual_ids);
+        ASSERT_EQUAL_HINT(actual_ids, expected_ids, hint);
+        ASSERT_EQUAL_HINT(server.rating_index_.GetDocumentCount(), server.GetDocumentCount(), hint);
+
+        const std::vector<DocumentFilter> filters = {DocumentFilter().SetRatingRange(1000, std::numeric_limits<int>::max()),
+                                                     DocumentFilter().SetRatingRange(2000, 3000).SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::REMOVED}),
+                                                     DocumentFilter().SetRatingRange(1000, 5000).SetIdRange(0, 4000)};
+        for (const std::string &query : {"w0 w1"s, "w0 w2 -w3"s, "w1 w4 w5"s})
+        {
+            for (const DocumentFilter &filter : filters)
+            {
+                const auto lambda = [&filter](int document_id, DocumentStatus status, int rating)
+                { return filter(document_id, status, rating); };
+                const std::vector<Document> expected = server.FindTopDocuments(query, lambda, 10);
+                for (const std::vector<Document> &actual : {server.FindTopDocuments(query, filter, 10), server.FindTopDocuments(std::execution::par, query, filter, 10)})
+                {
+                    ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint + ": rating index search should match the lambda for \""s + query + "\""s);
+                    for (std::size_t i = 0; i < actual.size(); ++i)
+                    {
+                        ASSERT_EQUAL(actual[i].id, expected[i].id);
+                        ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+                    }
+                }
+            }
+        }
+    };
+    check(server, "Updated server"s);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test_rating_index.bin").string();
+    server.SaveIndex(path);
+    {
+        SearchServer opened = SearchServer::OpenIndex(path);
+        check(opened, "Opened index"s);
+        opened.AddDocument(100'000, "w0 w1"s, DocumentStatus::ACTUAL, {4000});
+        check(opened, "Opened index after addition"s);
+    }
+    std::filesystem::remove(path);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void Tests::TestSearchServer() {
     RUN_TEST(Tests::TestDocumentAddition);
@@ -532,4 +2086,30 @@ void Tests::TestSearchServer() {
     RUN_TEST(Tests::TestSearchDocumentsWithSelectedStatus);
     RUN_TEST(Tests::TestFilterDocumentsUsingPredicate);
     RUN_TEST(Tests::TestSprint6Functional);
+    RUN_TEST(Tests::TestTermDictionary);
+    RUN_TEST(Tests::TestPostingList);
+    RUN_TEST(Tests::TestBitPacking);
+    RUN_TEST(Tests::TestCompressedPostingList);
+    RUN_TEST(Tests::TestSplitIntoWords);
+    RUN_TEST(Tests::TestParallelFindTopDocuments);
+    RUN_TEST(Tests::TestConcurrentMap);
+    RUN_TEST(Tests::TestMaxResultCount);
+    RUN_TEST(Tests::TestProcessQueries);
+    RUN_TEST(Tests::TestRemoveDocuments);
+    RUN_TEST(Tests::TestAddDocuments);
+    RUN_TEST(Tests::TestCachedIDF);
+    RUN_TEST(Tests::TestDenseDocumentIndex);
+    RUN_TEST(Tests::TestScoreAccumulator);
+    RUN_TEST(Tests::TestExcludedDocuments);
+    RUN_TEST(Tests::TestSaveAndOpenIndex);
+    RUN_TEST(Tests::TestWriteAheadLog);
+    RUN_TEST(Tests::TestQueryResultCache);
+    RUN_TEST(Tests::TestSnapshotSearchServer);
+    RUN_TEST(Tests::TestSegmentedSearchServer);
+    RUN_TEST(Tests::TestPostingListCursor);
+    RUN_TEST(Tests::TestPostingListBlockBounds);
+    RUN_TEST(Tests::TestTopDocumentsPruning);
+    RUN_TEST(Tests::TestStatusPartitions);
+    RUN_TEST(Tests::TestDocumentFilter);
+    RUN_TEST(Tests::TestRatingIndex);
 }
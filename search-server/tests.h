@@ -18,6 +18,32 @@ class Tests
     static void TestSearchDocumentsWithSelectedStatus();
     static void TestFilterDocumentsUsingPredicate();
     static void TestSprint6Functional();
+    static void TestTermDictionary();
+    static void TestPostingList();
+    static void TestBitPacking();
+    static void TestCompressedPostingList();
+    static void TestSplitIntoWords();
+    static void TestParallelFindTopDocuments();
+    static void TestConcurrentMap();
+    static void TestMaxResultCount();
+    static void TestProcessQueries();
+    static void TestRemoveDocuments();
+    static void TestAddDocuments();
+    static void TestCachedIDF();
+    static void TestDenseDocumentIndex();
+    static void TestScoreAccumulator();
+    static void TestExcludedDocuments();
+    static void TestSaveAndOpenIndex();
+    static void TestWriteAheadLog();
+    static void TestQueryResultCache();
+    static void TestSnapshotSearchServer();
+    static void TestSegmentedSearchServer();
+    static void TestPostingListCursor();
+    static void TestPostingListBlockBounds();
+    static void TestTopDocumentsPruning();
+    static void TestStatusPartitions();
+    static void TestDocumentFilter();
+    static void TestRatingIndex();
 };
 
 
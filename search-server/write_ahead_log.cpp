@@ -0,0 +1,257 @@
+#include "write_ahead_log.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+    // заголовок записи: длина данных, CRC32 номера и данных, номер записи
+    constexpr std::size_t RECORD_HEADER_SIZE = sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+    std::array<std::uint32_t, 256> MakeCrc32Table()
+    {
+        std::array<std::uint32_t, 256> table {};
+        for (std::uint32_t i = 0; i < table.size(); ++i)
+        {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }
+
+    template <typename T>
+    void AppendValue(std::string &buffer, const T &value)
+    {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T ReadValue(const char *data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    void WriteAll(int descriptor, const char *data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = write(descriptor, data, size);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written < 0)
+            {
+                throw std::runtime_error("Could not write to write-ahead log"s);
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+}
+
+std::uint32_t ComputeCrc32(const void *data, std::size_t size, std::uint32_t crc)
+{
+    static const std::array<std::uint32_t, 256> table = MakeCrc32Table();
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+WriteAheadLog::WriteAheadLog(const std::string &path, std::uint64_t next_sequence_number)
+    : next_sequence_number_(next_sequence_number), durable_sequence_number_(next_sequence_number - 1)
+{
+    descriptor_ = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (descriptor_ < 0)
+    {
+        throw std::runtime_error("Could not open write-ahead log "s + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    try
+    {
+        Flush();
+    }
+    catch (const std::runtime_error &)
+    {
+        // из деструктора исключение не выпускаем; недописанные записи при восстановлении не найдутся
+    }
+    close(descriptor_);
+}
+
+std::uint64_t WriteAheadLog::Append(std::string_view payload)
+{
+    std::lock_guard guard(mutex_);
+    if (is_failed_)
+    {
+        throw std::runtime_error("Write-ahead log is broken by a failed write"s);
+    }
+    const std::uint64_t sequence_number = next_sequence_number_++;
+    const std::uint32_t crc = ComputeCrc32(payload.data(), payload.size(), ComputeCrc32(&sequence_number, sizeof(sequence_number)));
+    AppendValue(buffer_, static_cast<std::uint32_t>(payload.size()));
+    AppendValue(buffer_, crc);
+    AppendValue(buffer_, sequence_number);
+    buffer_.append(payload);
+    return sequence_number;
+}
+
+void WriteAheadLog::WaitDurable(std::uint64_t sequence_number)
+{
+    std::unique_lock lock(mutex_);
+    FlushLocked(lock, sequence_number);
+}
+
+void WriteAheadLog::Flush()
+{
+    std::unique_lock lock(mutex_);
+    FlushLocked(lock, next_sequence_number_ - 1);
+}
+
+void WriteAheadLog::FlushLocked(std::unique_lock<std::mutex> &lock, std::uint64_t sequence_number)
+{
+    while (durable_sequence_number_ < sequence_number)
+    {
+        if (is_failed_)
+        {
+            // потерянная группа могла содержать и нашу запись, а всё после неё Replay отрежет
+            throw std::runtime_error("Write-ahead log is broken by a failed write"s);
+        }
+        if (is_flushing_)
+        {
+            // диск занят чужой группой; наша запись уйдёт со следующей
+            flushed_.wait(lock);
+            continue;
+        }
+        // становимся ведущим: забираем всё накопленное, пишем и синхронизируем без блокировки
+        is_flushing_ = true;
+        std::string group;
+        group.swap(buffer_);
+        const std::uint64_t group_last = next_sequence_number_ - 1;
+        lock.unlock();
+        bool is_written = true;
+        try
+        {
+            WriteAll(descriptor_, group.data(), group.size());
+            is_written = fdatasync(descriptor_) == 0;
+        }
+        catch (const std::runtime_error &)
+        {
+            is_written = false;
+        }
+        lock.lock();
+        is_flushing_ = false;
+        if (is_written)
+        {
+            durable_sequence_number_ = group_last;
+        }
+        else
+        {
+            is_failed_ = true;
+        }
+        flushed_.notify_all();
+        if (!is_written)
+        {
+            throw std::runtime_error("Could not sync write-ahead log"s);
+        }
+    }
+}
+
+std::uint64_t WriteAheadLog::GetLastSequenceNumber()
+{
+    std::lock_guard guard(mutex_);
+    return next_sequence_number_ - 1;
+}
+
+void WriteAheadLog::Truncate()
+{
+    std::unique_lock lock(mutex_);
+    FlushLocked(lock, next_sequence_number_ - 1);
+    if (ftruncate(descriptor_, 0) != 0 || fdatasync(descriptor_) != 0)
+    {
+        is_failed_ = true;
+        throw std::runtime_error("Could not truncate write-ahead log"s);
+    }
+}
+
+std::uint64_t WriteAheadLog::Replay(const std::string &path, const std::function<void(std::uint64_t, std::string_view)> &func)
+{
+    const int descriptor = open(path.c_str(), O_RDWR);
+    if (descriptor < 0)
+    {
+        return 0;
+    }
+    // хвост режется только по целиком прочитанному файлу: короткий буфер из-за ошибки чтения
+    // отрезал бы записи, уже подтверждённые писателям
+    std::vector<char> data;
+    char chunk[1 << 16];
+    while (true)
+    {
+        const ssize_t read_size = read(descriptor, chunk, sizeof(chunk));
+        if (read_size == 0)
+        {
+            break;
+        }
+        if (read_size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            close(descriptor);
+            throw std::runtime_error("Could not read write-ahead log "s + path);
+        }
+        data.insert(data.end(), chunk, chunk + read_size);
+    }
+
+    std::uint64_t last_sequence_number = 0;
+    std::size_t position = 0;
+    while (data.size() - position >= RECORD_HEADER_SIZE)
+    {
+        const char *header = data.data() + position;
+        const auto payload_size = ReadValue<std::uint32_t>(header);
+        const auto crc = ReadValue<std::uint32_t>(header + sizeof(std::uint32_t));
+        const auto sequence_number = ReadValue<std::uint64_t>(header + 2 * sizeof(std::uint32_t));
+        if (payload_size > data.size() - position - RECORD_HEADER_SIZE)
+        {
+            break;
+        }
+        const std::string_view payload(header + RECORD_HEADER_SIZE, payload_size);
+        if (ComputeCrc32(payload.data(), payload.size(), ComputeCrc32(&sequence_number, sizeof(sequence_number))) != crc)
+        {
+            break;
+        }
+        func(sequence_number, payload);
+        last_sequence_number = sequence_number;
+        position += RECORD_HEADER_SIZE + payload_size;
+    }
+    // цикл выше останавливается раньше конца только на недописанной или испорченной записи:
+    // всё после последней целой записи не было подтверждено ни одному писателю
+    if (position < data.size() && ftruncate(descriptor, static_cast<off_t>(position)) != 0)
+    {
+        close(descriptor);
+        throw std::runtime_error("Could not cut broken tail of write-ahead log "s + path);
+    }
+    close(descriptor);
+    return last_sequence_number;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// журнал изменений, дописываемый только в конец. Запись: длина данных, CRC32, номер записи, данные.
+// Записи из разных потоков копятся в буфере, и один поток сбрасывает на диск сразу всю группу
+// одним fsync - остальные только ждут, пока их запись окажется на диске
+class WriteAheadLog
+{
+public:
+    // открывает журнал для дописывания, создавая файл, если его нет. Номера новых записей
+    // начинаются с next_sequence_number. Бросает std::runtime_error, если файл не открылся
+    WriteAheadLog(const std::string& path, std::uint64_t next_sequence_number);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // кладёт запись в буфер и возвращает её номер; на диск она попадёт при ближайшем WaitDurable.
+    // Бросает std::runtime_error, если журнал сломан неудачной записью
+    std::uint64_t Append(std::string_view payload);
+
+    // ждёт, пока запись с этим номером и все до неё окажутся на диске. После первой неудачной записи
+    // или синхронизации журнал ломается: этот и все последующие вызовы бросают std::runtime_error
+    void WaitDurable(std::uint64_t sequence_number);
+
+    // сбрасывает на диск всё, что уже добавлено
+    void Flush();
+
+    // номер последней добавленной записи
+    std::uint64_t GetLastSequenceNumber();
+
+    // очищает журнал: вызывается после снимка, в который вошли все записи журнала
+    void Truncate();
+
+    // проходит по целым записям журнала, func(sequence_number, payload).
+    // Недописанный или испорченный хвост - след падения посреди записи - отрезается от файла.
+    // Возвращает номер последней прочитанной записи или 0, если файла нет или он пуст
+    static std::uint64_t Replay(const std::string& path, const std::function<void(std::uint64_t, std::string_view)>& func);
+
+private:
+    int descriptor_ = -1;
+    std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::string buffer_;
+    std::uint64_t next_sequence_number_;
+    // номер последней записи, которая уже на диске
+    std::uint64_t durable_sequence_number_;
+    bool is_flushing_ = false;
+    // группа не дописалась или не синхронизировалась: в файле мог остаться обрывок записи, за которым
+    // Replay ничего не прочтёт, поэтому больше ничего не пишем и никому не подтверждаем
+    bool is_failed_ = false;
+
+    // сбрасывает буфер, если этого ещё никто не делает; вызывается под захваченным lock
+    void FlushLocked(std::unique_lock<std::mutex>& lock, std::uint64_t sequence_number);
+};
+
+// CRC32 (многочлен IEEE 802.3)
+std::uint32_t ComputeCrc32(const void* data, std::size_t size, std::uint32_t crc = 0);
+